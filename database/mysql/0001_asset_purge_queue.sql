@@ -0,0 +1,11 @@
+-- Queue of fty::db::Purge (fty_common_db_purge.h)
+-- Assets leave the queue once purged, assets which cannot be deleted stay with failed = 1 until queued again.
+
+CREATE TABLE IF NOT EXISTS t_bios_asset_purge_queue (
+    id_asset_element INT UNSIGNED NOT NULL,
+    scope            ENUM('ext_attributes', 'links', 'asset') NOT NULL,
+    enqueued_at      TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    failed           TINYINT(1) NOT NULL DEFAULT 0,
+    PRIMARY KEY (id_asset_element, scope),
+    INDEX (failed, enqueued_at)
+);
@@ -0,0 +1,13 @@
+-- Change journal of DBAssets::enable_change_journal (fty_common_db_asset_journal.h)
+-- No foreign key on id_asset_element, changes of deleted assets must stay in the journal.
+
+CREATE TABLE IF NOT EXISTS t_bios_asset_change_journal (
+    id_change        BIGINT UNSIGNED NOT NULL AUTO_INCREMENT,
+    id_asset_element INT UNSIGNED NOT NULL,
+    table_name       VARCHAR(64) NOT NULL,
+    operation        ENUM('insert', 'update', 'delete') NOT NULL,
+    changed_at       TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (id_change),
+    INDEX (id_asset_element),
+    INDEX (changed_at)
+);
@@ -0,0 +1,65 @@
+-- Materialised configured state of DBAssets::enable_configured_table (fty_common_db_asset_configured.h)
+-- configured: 1 configured, 0 not configured, NULL if the option does not apply to the asset
+-- The state is computed by the library. The triggers drop the state of every asset whose inputs are changed by any
+-- writer; filters compute the state of assets without a row at query time, so the table is never stale.
+
+CREATE TABLE IF NOT EXISTS t_bios_asset_configured (
+    id_asset_element INT UNSIGNED NOT NULL,
+    configured       TINYINT NULL,
+    PRIMARY KEY (id_asset_element),
+    INDEX (configured)
+);
+
+DROP TRIGGER IF EXISTS tr_bios_asset_configured_element_update;
+DROP TRIGGER IF EXISTS tr_bios_asset_configured_element_delete;
+DROP TRIGGER IF EXISTS tr_bios_asset_configured_link_insert;
+DROP TRIGGER IF EXISTS tr_bios_asset_configured_link_update;
+DROP TRIGGER IF EXISTS tr_bios_asset_configured_link_delete;
+
+DELIMITER //
+
+-- type, subtype and parent of the asset, and the parent of the parent of its children (sensors)
+CREATE TRIGGER tr_bios_asset_configured_element_update
+AFTER UPDATE ON t_bios_asset_element
+FOR EACH ROW
+BEGIN
+    IF NOT (OLD.id_type <=> NEW.id_type AND OLD.id_subtype <=> NEW.id_subtype AND OLD.id_parent <=> NEW.id_parent) THEN
+        DELETE FROM t_bios_asset_configured
+        WHERE
+            id_asset_element = NEW.id_asset_element OR
+            id_asset_element IN (
+                SELECT id_asset_element FROM t_bios_asset_element WHERE id_parent = NEW.id_asset_element);
+    END IF;
+END //
+
+CREATE TRIGGER tr_bios_asset_configured_element_delete
+AFTER DELETE ON t_bios_asset_element
+FOR EACH ROW
+BEGIN
+    DELETE FROM t_bios_asset_configured WHERE id_asset_element = OLD.id_asset_element;
+END //
+
+-- power chain of the destination
+CREATE TRIGGER tr_bios_asset_configured_link_insert
+AFTER INSERT ON t_bios_asset_link
+FOR EACH ROW
+BEGIN
+    DELETE FROM t_bios_asset_configured WHERE id_asset_element = NEW.id_asset_device_dest;
+END //
+
+CREATE TRIGGER tr_bios_asset_configured_link_update
+AFTER UPDATE ON t_bios_asset_link
+FOR EACH ROW
+BEGIN
+    DELETE FROM t_bios_asset_configured
+    WHERE id_asset_element IN (OLD.id_asset_device_dest, NEW.id_asset_device_dest);
+END //
+
+CREATE TRIGGER tr_bios_asset_configured_link_delete
+AFTER DELETE ON t_bios_asset_link
+FOR EACH ROW
+BEGIN
+    DELETE FROM t_bios_asset_configured WHERE id_asset_element = OLD.id_asset_device_dest;
+END //
+
+DELIMITER ;
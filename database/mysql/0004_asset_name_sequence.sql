@@ -0,0 +1,8 @@
+-- Blocks of suffixes of internal asset names reserved by fty::db::SuffixAllocator (fty_common_db_suffix.h)
+-- The id of a block is its number, block n covers suffixes [(n - 1) * 64, n * 64).
+
+CREATE TABLE IF NOT EXISTS t_bios_asset_name_sequence (
+    id_block    BIGINT UNSIGNED NOT NULL AUTO_INCREMENT,
+    reserved_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (id_block)
+);
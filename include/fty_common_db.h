@@ -37,11 +37,23 @@ typedef struct _fty_common_db_uptime_t fty_common_db_uptime_t;
 #define FTY_COMMON_DB_UPTIME_T_DEFINED
 
 #include "fty_common_db_asset.h"
+#include "fty_common_db_cache.h"
+#include "fty_common_db_asset_batch.h"
+#include "fty_common_db_asset_bulk.h"
+#include "fty_common_db_asset_configured.h"
 #include "fty_common_db_asset_delete.h"
+#include "fty_common_db_asset_filter.h"
 #include "fty_common_db_asset_insert.h"
+#include "fty_common_db_asset_journal.h"
 #include "fty_common_db_asset_update.h"
 #include "fty_common_db_dbpath.h"
 #include "fty_common_db_defs.h"
 #include "fty_common_db_exception.h"
+#include "fty_common_db_notifier.h"
+#include "fty_common_db_purge.h"
+#include "fty_common_db_result.h"
+#include "fty_common_db_singleflight.h"
+#include "fty_common_db_suffix.h"
 #include "fty_common_db_uptime.h"
+#include "fty_common_db_writebehind.h"
 #include "fty_common_db_connection.h"
@@ -22,7 +22,9 @@
 #pragma once
 
 // Note: Consumers MUST be built with C++11 or newer standard due to this:
+#include "fty_common_db_asset_filter.h"
 #include "fty_common_db_defs.h"
+#include "fty_common_db_result.h"
 
 namespace DBAssets {
 
@@ -83,6 +85,26 @@ int select_assets_by_container(tntdb::Connection& conn, uint32_t element_id, std
     std::vector<uint16_t> subtypes, const std::string& without, const std::string& status,
     const std::string &configured, std::function<void(const tntdb::Row&)> cb);
 
+// select_assets_by_container: selects assets from given container matching filter
+// returns 0 if succesful
+// returns -1 if error occurs
+int select_assets_by_container(
+    tntdb::Connection& conn, uint32_t element_id, const AssetFilter& filter, std::function<void(const tntdb::Row&)> cb);
+
+// select_assets_by_container: selects one page of assets from given container matching filter
+// returns 0 if succesful
+// returns -1 if error occurs
+int select_assets_by_container(tntdb::Connection& conn, uint32_t element_id, const AssetFilter& filter,
+    const AssetPage& page, std::function<void(const tntdb::Row&)> cb);
+
+// select_assets_by_containers: selects assets from all given containers matching filter in one query
+// (one per 256 containers), cb is called with id of the container and the same row as select_assets_by_container
+// with additional column container_id; an asset under several of given containers is reported for each of them
+// returns 0 if succesful
+// returns -1 if error occurs
+int select_assets_by_containers(tntdb::Connection& conn, const std::vector<uint32_t>& container_ids,
+    const AssetFilter& filter, std::function<void(uint32_t, const tntdb::Row&)> cb);
+
 int select_assets_by_container(tntdb::Connection& conn, uint32_t element_id, std::vector<uint16_t> types,
     std::vector<uint16_t> subtypes, const std::string& without, const std::string& status,
     std::function<void(const tntdb::Row&)> cb);
@@ -122,6 +144,41 @@ int select_assets_all_container(tntdb::Connection& conn, std::vector<uint16_t> t
     const std::string& without, const std::string& status, const std::string& configured,
     std::function<void(const tntdb::Row&)> cb);
 
+// select_assets_all_container: selects all assets (with and without container) matching filter
+// return 0 on success (even if nothing was found)
+// returns -1 if error occurs
+int select_assets_all_container(
+    tntdb::Connection& conn, const AssetFilter& filter, std::function<void(const tntdb::Row&)> cb);
+
+// select_assets_all_container: selects one page of all assets (with and without container) matching filter
+// return 0 on success (even if nothing was found)
+// returns -1 if error occurs
+int select_assets_all_container(tntdb::Connection& conn, const AssetFilter& filter, const AssetPage& page,
+    std::function<void(const tntdb::Row&)> cb);
+
+// count_assets_by_container: number of assets from given container matching filter
+// returns value < 0 if error ocurrs
+int64_t count_assets_by_container(tntdb::Connection& conn, uint32_t element_id, const AssetFilter& filter);
+
+// count_assets_by_container: numbers of assets from given container matching filter, grouped by
+// type (key is type name), subtype (key is subtype name) or status
+// returns 0 if succesful
+// returns -1 if error occurs
+int count_assets_by_container(tntdb::Connection& conn, uint32_t element_id, const AssetFilter& filter,
+    AssetFilter::Aggregate group, std::map<std::string, uint64_t>& counts);
+
+// count_assets_all_container: number of all assets (with and without container) matching filter
+// use filter.without = "location" for assets without container, empty filter for all assets
+// returns value < 0 if error ocurrs
+int64_t count_assets_all_container(tntdb::Connection& conn, const AssetFilter& filter);
+
+// count_assets_all_container: numbers of all assets (with and without container) matching filter, grouped by
+// type (key is type name), subtype (key is subtype name) or status
+// returns 0 if succesful
+// returns -1 if error occurs
+int count_assets_all_container(tntdb::Connection& conn, const AssetFilter& filter, AssetFilter::Aggregate group,
+    std::map<std::string, uint64_t>& counts);
+
 // select_assets_all_container: selects all assets (with and wihout container)
 // return 0 on success (even if nothing was found)
 // returns -1 if error occurs
@@ -136,6 +193,11 @@ int select_asset_element_by_dc(tntdb::Connection& conn, int64_t dc_id, std::func
 // returns -1 in case of error or 0 for success
 int select_asset_element_all(tntdb::Connection& conn, std::function<void(const tntdb::Row&)>& cb);
 
+// select_asset_element_all: select one page from v_web_element
+// returns -1 in case of error or 0 for success
+int select_asset_element_all(
+    tntdb::Connection& conn, const AssetPage& page, std::function<void(const tntdb::Row&)>& cb);
+
 // convert_asset_to_monitor: converts asset id to monitor id
 // return  0 on success (even if counterpart was not found)
 // returns -1 if error occurs
@@ -189,6 +251,7 @@ int select_asset_ext_attribute_by_keytag(tntdb::Connection& conn, const std::str
 // select_ext_rw_attributes_keytags: select all read-write ext attributes
 // returns -1 in case of error or 0 for success
 int select_ext_rw_attributes_keytags(tntdb::Connection& conn, std::function<void(const tntdb::Row&)>& cb);
+int select_ext_rw_attributes_keytags(tntdb::Connection& conn, std::vector<std::string>& keytags);
 
 // select_ext_attributes: select all ext_attributes of asset
 // returns -1 in case of error or 0 for success
@@ -197,6 +260,10 @@ db_reply<std::map<std::string, std::pair<std::string, bool>>> select_ext_attribu
 int select_ext_attributes(
     tntdb::Connection& conn, uint32_t element_id, std::map<std::string, std::pair<std::string, bool>>& out);
 
+// read_ext_attributes: select all ext_attributes of asset, as select_ext_attributes without copying the map
+fty::db::Result<std::map<std::string, std::pair<std::string, bool>>> read_ext_attributes(
+    tntdb::Connection& conn, uint32_t element_id);
+
 // select_ext_attributes_cb: select ass ext attributes of asset, process with cb
 // returns -1 in case of error or 0 for success
 int select_ext_attributes_cb(tntdb::Connection& conn, uint32_t asset_id, std::function<void(const tntdb::Row&)> cb);
@@ -209,6 +276,10 @@ int select_asset_element_basic_cb(
 // select_assets_cb: select data about all assets from v_bios_asset_element, process with cb
 // return -1 in case of error or asset not found, 0 otherwise
 int select_assets_cb(tntdb::Connection& conn, std::function<void(const tntdb::Row&)> cb);
+
+// select_assets_cb: select one page of data about assets from v_bios_asset_element, process with cb
+// returns -1 in case of error or 0 for success
+int select_assets_cb(tntdb::Connection& conn, const AssetPage& page, std::function<void(const tntdb::Row&)> cb);
 // --------------------------------------------------------------------
 
 // select_monitor_device_type_id: select id based on name from v_bios_device_type
@@ -232,25 +303,53 @@ db_reply<db_web_basic_element_t> select_asset_element_web_byName(tntdb::Connecti
 db_reply<std::vector<db_tmp_link_t>> select_asset_device_links_to(
     tntdb::Connection& conn, uint32_t element_id, uint8_t link_type_id);
 
+// read_asset_device_links_to: as select_asset_device_links_to without copying the vector
+fty::db::Result<std::vector<db_tmp_link_t>> read_asset_device_links_to(
+    tntdb::Connection& conn, uint32_t element_id, uint8_t link_type_id);
+
 // select_asset_element_groups: get information about the groups element belongs to
 // db_reply.status == 0 means error or not found, 1 means success
 
 db_reply<std::map<uint32_t, std::string>> select_asset_element_groups(tntdb::Connection& conn, uint32_t element_id);
 
+// read_asset_element_groups: as select_asset_element_groups without copying the map
+fty::db::Result<std::map<uint32_t, std::string>> read_asset_element_groups(
+    tntdb::Connection& conn, uint32_t element_id);
+
+// select_asset_full: get basic data, ext attributes, groups, power links and parents of an asset in one round trip
+// (replaces select_asset_element_web_by*, select_ext_attributes, select_asset_element_groups,
+// select_asset_device_links_to and select_asset_element_super_parent sequence)
+// db_reply.status == 0 means error or not found, 1 means success
+
+db_reply<db_web_element_t> select_asset_full(tntdb::Connection& conn, uint32_t element_id);
+db_reply<db_web_element_t> select_asset_full(tntdb::Connection& conn, const std::string& element_name);
+
 // select_short_elements: select all devices of certain type/subtype
 // db_reply.status == 0 means error or not found, 1 means success
 
 db_reply<std::map<uint32_t, std::string>> select_short_elements(
     tntdb::Connection& conn, uint16_t type_id, uint16_t subtype_id);
 
+// read_short_elements: as select_short_elements without copying the map
+fty::db::Result<std::map<uint32_t, std::string>> read_short_elements(
+    tntdb::Connection& conn, uint16_t type_id, uint16_t subtype_id);
+
 // select_asset_elements_by_type: returns assets for given type
 db_reply<std::vector<db_a_elmnt_t>> select_asset_elements_by_type(
     tntdb::Connection& conn, uint16_t type_id, std::string status);
 
+// read_asset_elements_by_type: as select_asset_elements_by_type without copying the vector
+fty::db::Result<std::vector<db_a_elmnt_t>> read_asset_elements_by_type(
+    tntdb::Connection& conn, uint16_t type_id, const std::string& status);
+
 // select_links_by_container: returns power links for given container
 db_reply<std::set<std::pair<uint32_t, uint32_t>>> select_links_by_container(
     tntdb::Connection& conn, uint32_t element_id, std::string status);
 
+// read_links_by_container: as select_links_by_container without copying the set
+fty::db::Result<std::set<std::pair<uint32_t, uint32_t>>> read_links_by_container(
+    tntdb::Connection& conn, uint32_t element_id, const std::string& status);
+
 // list_devices_with_status: returns active/inactive devices
 std::vector<std::string> list_devices_with_status(tntdb::Connection& conn, std::string status);
 
@@ -281,4 +380,7 @@ std::set<std::string> get_linked_devices(tntdb::Connection conn, const std::stri
 // daisy_chain ext properties, or empty map if not part of a daisy-chain
 // (1 -> asset_internal_name_1, 2 -> asset_internal_name_2...)
 db_reply<std::map<int, std::string>> select_daisy_chain(tntdb::Connection& conn, const std::string& asset_id);
+
+// read_daisy_chain: as select_daisy_chain without copying the map
+fty::db::Result<std::map<int, std::string>> read_daisy_chain(tntdb::Connection& conn, const std::string& asset_id);
 } // namespace DBAssets
@@ -0,0 +1,87 @@
+/*  =========================================================================
+    fty_common_db_asset_batch - Coalescing of per-asset lookups
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_common_db_defs.h"
+#include <map>
+#include <set>
+#include <string>
+
+namespace DBAssets {
+
+// BatchScope: coalesce per-asset lookups into IN (...) queries
+//
+// While a scope is alive in the current thread, select_ext_attributes(conn, id) and get_status_from_db(conn, name)
+// are served by it. Lookups announced with want_*() are queued and fetched together by flush() or by the first
+// lookup that needs any of them. Lookups which were not announced are queued and fetched on demand.
+// Results stay valid for the lifetime of the scope, so keep scopes short (one walk over select_assets_cb result).
+// Scopes can be nested, the innermost one is used.
+//
+// Example:
+//     DBAssets::BatchScope batch;
+//     select_assets_cb(conn, [&](const tntdb::Row& r) { uint32_t id; r["id"].get(id); batch.want_ext_attributes(id); ...});
+//     for (...) { select_ext_attributes(conn, id, ext); } // one query for all ids
+class BatchScope
+{
+public:
+    using ext_attributes_t = std::map<std::string, std::pair<std::string, bool>>;
+
+    BatchScope();
+    ~BatchScope();
+
+    BatchScope(const BatchScope&) = delete;
+    BatchScope& operator=(const BatchScope&) = delete;
+
+    // want_ext_attributes: queue lookup of ext attributes of given asset
+    void want_ext_attributes(uint32_t element_id);
+
+    // want_status: queue lookup of status of given asset, ignored for names with non-ASCII characters
+    void want_status(const std::string& element_name);
+
+    // flush: fetch all queued lookups
+    // returns -1 in case of error or 0 for success
+    int flush(tntdb::Connection& conn);
+
+    // ext_attributes: get ext attributes of asset, fetch them (and everything queued) if needed
+    // returns false in case of error
+    bool ext_attributes(tntdb::Connection& conn, uint32_t element_id, ext_attributes_t& out);
+
+    // status: get status of asset ("unknown" if there is no such asset), fetch it (and everything queued) if needed
+    // returns false in case of error, or if the name has non-ASCII characters or may match one (names are compared
+    // by the collation of MySQL, which ignores accents too), the caller has to query such asset alone
+    bool status(tntdb::Connection& conn, const std::string& element_name, std::string& out);
+
+    // current: innermost scope of the calling thread, nullptr if there is none
+    static BatchScope* current();
+
+private:
+    int flush_ext_attributes(tntdb::Connection& conn);
+    int flush_status(tntdb::Connection& conn);
+
+    BatchScope*                          m_previous;
+    std::set<uint32_t>                   m_ext_pending;
+    std::map<uint32_t, ext_attributes_t> m_ext;
+    std::set<std::string>                m_status_pending;
+    std::map<std::string, std::string>   m_status; // by lower case name without trailing spaces
+};
+
+} // namespace DBAssets
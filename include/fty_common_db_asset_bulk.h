@@ -0,0 +1,132 @@
+/*  =========================================================================
+    fty_common_db_asset_bulk - Bulk creation of assets
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_common_db_defs.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace DBAssetsInsert {
+
+// db_asset_link_spec_t: power link to the created asset
+struct db_asset_link_spec_t
+{
+    std::string src_name;                     // name of existing source device
+    int         src_index = -1;               // or index of source device created by the same call
+    std::string src_out;                      // outlet in source, empty for none
+    std::string dest_in;                      // inlet in created asset, empty for none
+    uint16_t    type      = INPUT_POWER_CHAIN; // link type id
+};
+
+// db_asset_spec_t: asset to be created by insert_assets
+struct db_asset_spec_t
+{
+    std::string name;                                                 // internal name (prefix, see add_suffix)
+    bool        add_suffix   = true;                                  // append "-NNNNNNNN" as insert_into_asset_element
+    uint16_t    type_id      = 0;                                     // type id
+    uint16_t    subtype_id   = 0;                                     // subtype id, 0 for N_A
+    uint32_t    parent_id    = 0;                                     // id of existing parent
+    int         parent_index = -1;                                    // or index of an earlier spec
+    std::string status       = "active";                              // "active" or "nonactive"
+    uint16_t    priority     = 5;                                     // 1 - 5
+    std::string asset_tag;                                            // empty for none
+    std::map<std::string, std::pair<std::string, bool>> ext;          // keytag -> (value, read only)
+    std::set<std::string>                               groups;       // names of existing groups
+    std::vector<db_asset_link_spec_t>                   links;        // power links to this asset
+};
+
+// db_asset_create_t: outcome of one spec
+struct db_asset_create_t
+{
+    int         status = 0; // 1 if created
+    uint32_t    id     = 0; // id of created asset
+    std::string name;       // internal name of created asset
+    std::string msg;        // reason of failure
+};
+
+// insert_assets: create assets with their ext attributes, groups and power links
+// All specs are validated and all referenced names are resolved first (one query per 256 names), invalid specs
+// (and specs depending on them) are reported as failed and skipped. The rest is inserted in one transaction with
+// multi-row statements per table, parents before children. Identical links of one spec are inserted once, specs with
+// links whose source or destination is not a device fail.
+// item has one entry per spec, in the same order
+// returns status 0 if the transaction failed (then nothing was created)
+db_reply<std::vector<db_asset_create_t>> insert_assets(
+    tntdb::Connection& conn, const std::vector<db_asset_spec_t>& specs);
+
+// db_link_insert_t: outcome of one link, the same as insert_into_asset_link would return
+struct db_link_insert_t
+{
+    int         status        = 0; // 1 if input was valid and the link was processed
+    uint64_t    affected_rows = 0; // 1 if inserted, 0 if suppressed (duplicate or not a device)
+    std::string msg;               // reason of failure or suppression
+};
+
+// insert_asset_links: insert power links with one classification query and one insert per 256 links
+// Links whose devices do not exist and links which already exist (or repeat in links) with the same src_out and
+// dest_in are suppressed as insert_into_asset_link does, including links inserted concurrently by someone else.
+// Each chunk runs in its own transaction, a chunk failing leaves previous chunks inserted.
+// item has one entry per link, in the same order
+db_reply<std::vector<db_link_insert_t>> insert_asset_links(tntdb::Connection& conn, const std::vector<link_t>& links);
+
+// insert_new_asset_links: insert power links between assets given by name
+// names are resolved by one query per 256 names, link with unknown device is suppressed
+db_reply<std::vector<db_link_insert_t>> insert_new_asset_links(
+    tntdb::Connection& conn, const std::vector<new_link_t>& links);
+
+
+// AssetWriter: unit of work creating fully described assets (element, ext attributes, groups, power links and
+// monitor relations) in one transaction, with the round trips of insert_assets
+// Unlike insert_assets it is all or nothing: if any asset is invalid or any write fails, nothing is created and every
+// item tells why.
+//     DBAssetsInsert::AssetWriter writer(conn);
+//     size_t rack = writer.add(rack_spec);
+//     ups_spec.parent_index = int(rack);
+//     size_t ups = writer.add(ups_spec);
+//     writer.monitor(ups, monitor_id);
+//     auto ret = writer.commit(); // ret.item[ups].id
+class AssetWriter
+{
+public:
+    explicit AssetWriter(tntdb::Connection& conn);
+
+    // add: queue asset, returns its index (for parent_index, src_index and item of the reply)
+    size_t add(const db_asset_spec_t& spec);
+
+    // spec: queued asset, to amend it
+    db_asset_spec_t& spec(size_t index);
+
+    // monitor: relate queued asset to discovered device
+    void monitor(size_t index, uint16_t monitor_id);
+
+    // commit: write everything queued, the writer is empty afterwards
+    // returns one item per queued asset, affected_rows is the number of created assets
+    db_reply<std::vector<db_asset_create_t>> commit();
+
+private:
+    tntdb::Connection&                       m_conn;
+    std::vector<db_asset_spec_t>             m_specs;
+    std::vector<std::pair<size_t, uint16_t>> m_monitors; // (index, monitor id)
+};
+} // namespace DBAssetsInsert
@@ -0,0 +1,49 @@
+/*  =========================================================================
+    fty_common_db_asset_configured - Materialised configured state of assets
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_common_db_defs.h"
+
+namespace DBAssets {
+
+// The "configured" option of select_assets_by_container and select_assets_all_container checks parents, power chain
+// links and sensor parents of every row. With the configured table enabled, the state is kept per asset in
+// t_bios_asset_configured by the write functions of this library, and the filters become an indexed lookup.
+// The table and its triggers are created by the schema migration database/mysql/0003_asset_configured.sql. The
+// triggers drop the state of assets changed by any writer (other processes, or processes which did not enable the
+// table), and the filters compute the state of assets without a row at query time, so results are never stale; a
+// rebuild only makes the lookup fast again for them.
+
+// enable_configured_table: rebuild the table, then maintain and use it in this process
+// returns 0 if succesful
+// returns -1 if error occurs (e.g. the table is missing), the table is not used then
+int enable_configured_table(tntdb::Connection& conn);
+
+// disable_configured_table: stop maintaining and using the table, filters compute the state at query time again
+void disable_configured_table();
+
+// rebuild_configured_table: recompute the state of all assets
+// returns 0 if succesful
+// returns -1 if error occurs
+int rebuild_configured_table(tntdb::Connection& conn);
+
+} // namespace DBAssets
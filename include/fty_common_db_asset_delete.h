@@ -23,6 +23,7 @@
 
 #include "fty_common_db_defs.h"
 #include <tntdb/connect.h>
+#include <vector>
 
 namespace DBAssetsDelete {
 
@@ -67,4 +68,21 @@ db_reply_t delete_asset_element_from_asset_group(
 // delete_monitor_asset_relation_by_a: delete given asset from t_bios_monitor_asset_relation
 // returns error if input params are unacceptable or error happened during delete
 db_reply_t delete_monitor_asset_relation_by_a(tntdb::Connection& conn, uint32_t id);
+
+/////////////////////////////////////////////////////////////////////////////
+// db_delete_options_t: options of delete_assets
+struct db_delete_options_t
+{
+    bool subtree         = false; // delete also all assets located (recursively) in given ones
+    bool detach_children = false; // assets located in deleted ones and not deleted lose their parent, else it fails
+};
+
+// delete_assets: delete assets with everything referring to them
+// (power links from and to them, group memberships of them and in them, ext attributes, monitor relations)
+// in one transaction, with one statement per table and per 256 assets
+// item contains ids of deleted assets (with subtree)
+// returns error if some asset has children which are not deleted (and not detached) or error happened during delete,
+// then nothing is deleted
+db_reply<std::vector<uint32_t>> delete_assets(
+    tntdb::Connection& conn, const std::vector<uint32_t>& ids, const db_delete_options_t& options = {});
 } // namespace DBAssetsDelete
@@ -0,0 +1,115 @@
+/*  =========================================================================
+    fty_common_db_asset_filter - Filter of the asset listing functions
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_common_db_defs.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace DBAssets {
+
+// AssetFilter: filter of select_assets_by_container and select_assets_all_container
+//
+// compile() turns the filter into a parameterised statement. Values are bound, never pasted into SQL, and type and
+// subtype lists are padded to a power of two, so only a bounded set of statement shapes exists. The SQL text of
+// each shape is generated once per process and reused, which keeps the prepared statement cache effective.
+struct AssetFilter
+{
+    // scope: which entry point the statement is for
+    //   container  - assets under :containerid in v_bios_asset_element_super_parent
+    //   all        - all assets in t_bios_asset_element
+    //   containers - assets under any of given containers, rows start with container_id
+    enum class Scope
+    {
+        Container,
+        All,
+        Containers
+    };
+
+    // aggregate: what the statement returns
+    //   rows    - one row per asset (columns depend on scope)
+    //   count   - number of assets
+    //   type, subtype, status - pairs (value, number of assets) grouped by given column
+    enum class Aggregate
+    {
+        Rows,
+        Count,
+        Type,
+        Subtype,
+        Status
+    };
+
+    std::vector<uint16_t> types;      // type ids, empty for any
+    std::vector<uint16_t> subtypes;   // subtype ids, empty for any
+    std::string           status;     // "active", "nonactive", empty for any
+    std::string           without;    // "location", "powerchain", ext attribute keytag, empty for none
+    std::string           configured; // "yes", "no", "all" (or empty) for any
+
+    struct Plan
+    {
+        std::string                                      shape;   // identification of the statement shape
+        std::string                                      sql;     // statement text, shared by filters of the shape
+        std::vector<std::pair<std::string, uint32_t>>    numbers; // numeric parameters
+        std::vector<std::pair<std::string, std::string>> strings; // string parameters
+        bool                                             where;   // true if sql has a WHERE clause
+
+        // bind: set all parameters of the plan (:containerid is left to the caller)
+        void bind(tntdb::Statement& st) const;
+    };
+
+    // compile: build statement for given scope (but containers)
+    Plan compile(Scope scope, Aggregate aggregate = Aggregate::Rows) const;
+
+    // compile: build statement for containers scope, ids of containers are bound by the plan
+    // the list is not chunked, keep it at most 256 ids long to keep the number of shapes bounded
+    Plan compile(const std::vector<uint32_t>& containers, Aggregate aggregate = Aggregate::Rows) const;
+};
+
+// AssetPage: keyset pagination of the asset listing functions
+//
+// A page starts after the last row of the previous one (never OFFSET), so every page costs O(limit) whatever its
+// position. Pass id (and name when sorting by name) of the last returned row to get the next page; a page with
+// less than limit rows is the last one.
+struct AssetPage
+{
+    enum class SortKey
+    {
+        Id,
+        Name
+    };
+
+    SortKey     sort       = SortKey::Id;
+    uint32_t    after_id   = 0;   // id of the last row of the previous page, 0 for the first page
+    std::string after_name = {};  // name of the last row of the previous page, used when sorting by name;
+                                  // if empty, it is looked up by after_id
+    uint32_t    limit      = 100; // maximal number of rows
+
+    // sql: keyset condition, ORDER BY and LIMIT for a statement over given id and name columns
+    // where - true if the statement has no WHERE clause yet
+    std::string sql(const std::string& id_column, const std::string& name_column, bool where) const;
+
+    // bind: set parameters used by sql()
+    void bind(tntdb::Statement& st) const;
+};
+
+} // namespace DBAssets
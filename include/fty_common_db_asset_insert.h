@@ -24,7 +24,11 @@
 #include "fty_common_db_defs.h"
 #include <fty_common_asset_types.h>
 #include <inttypes.h>
+#include <iterator>
+#include <string>
 #include <tntdb/connect.h>
+#include <utility>
+#include <vector>
 
 namespace DBAssetsInsert {
 
@@ -38,6 +42,22 @@ db_reply_t insert_into_asset_ext_attribute(
 db_reply_t insert_into_asset_ext_attributes(
     tntdb::Connection& conn, uint32_t element_id, zhash_t* attributes, bool read_only, std::string& err);
 
+using ext_attribute_view_t = std::pair<const char*, const char*>; // keytag, value (NUL terminated)
+
+// insert_into_asset_ext_attributes: multi value insert for extended attributes given as keytag/value views
+// one statement per 256 attributes, the strings must stay valid during the call
+// does not open a transaction, the caller owns it and decides what happens to the chunks written before an error
+// returns error if any insert wasn't successful
+db_reply_t insert_into_asset_ext_attributes(tntdb::Connection& conn, uint32_t element_id,
+    const std::vector<ext_attribute_view_t>& attributes, bool read_only);
+
+// insert_into_asset_ext_attributes: multi value insert for extended attributes from any range of keytag/value pairs
+// keytags and values are std::string or const char*,
+// e.g. std::map<std::string, std::string> or std::vector<std::pair<const char*, std::string>>
+template <typename Range, typename = decltype(std::begin(std::declval<const Range&>()))>
+db_reply_t insert_into_asset_ext_attributes(
+    tntdb::Connection& conn, uint32_t element_id, const Range& attributes, bool read_only);
+
 //////////////////////////////////////////////////////////////////////////////
 // insert_asset_element_into_asset_group: insert group<->asset relation
 // returns error if input params are unacceptable or insert went wrong
@@ -75,4 +95,28 @@ db_reply_t insert_into_monitor_asset_relation(tntdb::Connection& conn, uint16_t
 // insert_into_monitor_device: insert name<->device_type relation
 // returns error if insert went wrong
 db_reply_t insert_into_monitor_device(tntdb::Connection& conn, uint16_t device_type_id, const char* device_name);
+
+// =====================================================================================================================
+
+inline const char* ext_attribute_c_str(const char* s)
+{
+    return s;
+}
+
+inline const char* ext_attribute_c_str(const std::string& s)
+{
+    return s.c_str();
+}
+
+template <typename Range, typename>
+inline db_reply_t insert_into_asset_ext_attributes(
+    tntdb::Connection& conn, uint32_t element_id, const Range& attributes, bool read_only)
+{
+    std::vector<ext_attribute_view_t> views;
+    for (const auto& [keytag, value] : attributes) {
+        views.emplace_back(ext_attribute_c_str(keytag), ext_attribute_c_str(value));
+    }
+    return insert_into_asset_ext_attributes(conn, element_id, views, read_only);
+}
+
 } // namespace DBAssetsInsert
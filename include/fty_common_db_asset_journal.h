@@ -0,0 +1,79 @@
+/*  =========================================================================
+    fty_common_db_asset_journal - Journal of asset changes
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_common_db_defs.h"
+#include "fty_common_db_result.h"
+#include <string>
+#include <vector>
+
+namespace DBAssets {
+
+struct db_asset_change_t
+{
+    uint64_t    revision;  // monotonically increasing id of the change
+    uint32_t    asset_id;  // changed asset (may not exist anymore)
+    std::string table;     // changed table, e.g. "t_bios_asset_ext_attributes"
+    std::string operation; // "insert", "update" or "delete"
+};
+
+// enable_change_journal: journal changes done by write functions of this process in t_bios_asset_change_journal,
+// which is created by the schema migration database/mysql/0002_asset_change_journal.sql (the library runs no DDL)
+// disabled by default; once enabled, changes are written with the changes themselves, in one batch per transaction
+// of fty::db::Transaction (or prepared ChangeNotifier::Deferral), one statement per write function otherwise
+// returns 0 if succesful
+// returns -1 if the journal table cannot be used, the journal stays disabled then
+int enable_change_journal(tntdb::Connection& conn);
+
+// disable_change_journal: stop journaling changes of this process
+void disable_change_journal();
+
+// change_journal_enabled: true if changes of this process are journaled
+bool change_journal_enabled();
+
+// prune_change_journal: delete changes older than max_age seconds and all but the newest max_rows changes
+// 0 disables a limit; rows are deleted by chunks of 10000 from the oldest one
+// the journal is never pruned automatically, call it on a schedule of the owner of the journal (e.g. daily), on
+// a connection of its own so that the deleted rows are not locked by a transaction
+// consumers of select_changes_since whose revision was pruned miss changes, they must do a full scan again
+// returns number of deleted changes
+// returns value < 0 if error occurs
+int64_t prune_change_journal(tntdb::Connection& conn, uint32_t max_age, uint64_t max_rows);
+
+// select_last_change_revision: revision of the latest change
+// take it before a full scan and pass it to select_changes_since afterwards
+// returns revision (0 if nothing changed yet)
+// returns value < 0 if error occurs
+int64_t select_last_change_revision(tntdb::Connection& conn);
+
+// select_changes_since: select changes with revision greater than given one, oldest first, at most limit of them
+// continue with revision of the last returned change until less than limit changes are returned
+// revisions are allocated at write time, a transaction committing late can publish a lower revision after
+// a higher one was read; consumers needing exactness should re-read a small window of past revisions
+db_reply<std::vector<db_asset_change_t>> select_changes_since(
+    tntdb::Connection& conn, uint64_t revision, uint32_t limit);
+
+// read_changes_since: as select_changes_since without copying the vector
+fty::db::Result<std::vector<db_asset_change_t>> read_changes_since(
+    tntdb::Connection& conn, uint64_t revision, uint32_t limit);
+
+} // namespace DBAssets
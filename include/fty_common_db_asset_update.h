@@ -21,7 +21,14 @@
 
 #pragma once
 
+#include "fty_common_db_defs.h"
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
 #include <tntdb/connect.h>
+#include <utility>
+#include <vector>
 
 namespace DBAssetsUpdate {
 
@@ -35,4 +42,74 @@ int update_asset_element(tntdb::Connection& conn, uint32_t element_id, const cha
 // update_asset_status_by_name: updates asset status
 int update_asset_status_by_name(const char* element_name, const char* status);
 
+// db_ext_delta_t: changes of ext attributes done by apply_ext_attributes
+struct db_ext_delta_t
+{
+    std::map<std::string, std::string> inserted; // keytag -> new value
+    std::map<std::string, std::string> updated;  // keytag -> new value (or read_only changed)
+    std::set<std::string>              deleted;  // keytags
+};
+
+// apply_ext_attributes: make ext attributes of asset with given read_only status equal to desired
+// Replaces delete_asset_ext_attributes_with_ro + insert_into_asset_ext_attributes: current attributes are read once
+// and only the difference is written (one delete, one insert and one upsert per 256 attributes) in a transaction.
+// Attributes with the other read_only status are kept, unless desired contains their keytag.
+// returns delta in item, status 0 if input params are unacceptable or something went wrong (nothing was changed)
+db_reply<db_ext_delta_t> apply_ext_attributes(tntdb::Connection& conn, uint32_t element_id,
+    const std::map<std::string, std::string>& desired, bool read_only);
+
+
+// db_group_delta_t: group memberships changed by set_group_membership(s) and add_members
+struct db_group_delta_t
+{
+    std::vector<std::pair<uint32_t, uint32_t>> added;   // (group, element)
+    std::vector<std::pair<uint32_t, uint32_t>> removed; // (group, element)
+};
+
+// set_group_membership: make asset member of exactly given groups
+// current memberships are read once, only the difference is written in a transaction
+// returns delta in item, status 0 if input params are unacceptable or something went wrong (nothing was changed)
+db_reply<db_group_delta_t> set_group_membership(
+    tntdb::Connection& conn, uint32_t element_id, const std::set<uint32_t>& groups);
+
+// set_group_memberships: set_group_membership of many assets (element -> groups) at once, e.g. for import
+// one query per 256 assets, one delete and one insert per 256 changed memberships
+db_reply<db_group_delta_t> set_group_memberships(
+    tntdb::Connection& conn, const std::map<uint32_t, std::set<uint32_t>>& memberships);
+
+// add_members: add assets to group, assets which already are members are skipped
+db_reply<db_group_delta_t> add_members(
+    tntdb::Connection& conn, uint32_t group_id, const std::vector<uint32_t>& element_ids);
+
+// set_status_bulk: set status of assets given by name with one statement per 256 names, in a transaction
+// Power devices (see get_active_power_devices) are locked while they are counted, so concurrent calls cannot exceed
+// max_active_power_devices together; activation which would exceed it (and increase the count) changes nothing.
+// Negative max_active_power_devices means no limit.
+// returns count of active power devices after the change in item, status 0 if input params are unacceptable,
+// the limit would be exceeded (errsubtype DB_ERROR_BADINPUT) or something went wrong
+db_reply<uint32_t> set_status_bulk(tntdb::Connection& conn, const std::vector<std::string>& names,
+    const std::string& status, int64_t max_active_power_devices = -1);
+
+// db_asset_update_t: fields of asset element to be changed, fields without value are not touched
+struct db_asset_update_t
+{
+    uint32_t                   id = 0;     // asset to be changed
+    std::optional<uint32_t>    parent_id;  // 0 for no parent
+    std::optional<std::string> status;     // "active" or "nonactive"
+    std::optional<uint16_t>    priority;   // 1 - 5
+    std::optional<std::string> asset_tag;  // empty for none
+    std::optional<uint16_t>    subtype_id; // 0 for N_A
+};
+
+// update_asset_element_fields: update only the fields which are set
+// one statement (cached) per combination of set fields
+// returns error if input params are unacceptable or something went wrong
+db_reply_t update_asset_element_fields(tntdb::Connection& conn, const db_asset_update_t& update);
+
+// update_asset_elements: update_asset_element_fields for many assets in a transaction
+// current values are read (and locked) first, only assets whose fields change are written and reported as changed;
+// assets with the same set fields are updated by one statement per 256 of them
+// returns error if any input param is unacceptable or an asset is given twice (then nothing was changed) or
+// something went wrong
+db_reply_t update_asset_elements(tntdb::Connection& conn, const std::vector<db_asset_update_t>& updates);
 } // namespace DBAssetsUpdate
@@ -0,0 +1,121 @@
+/*  =========================================================================
+    fty_common_db_cache - Table-version-aware cache of query results
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <any>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <tntdb/connect.h>
+#include <vector>
+
+namespace fty::db {
+
+// QueryCache: cache of results of read-mostly queries, keyed by statement and parameters
+//
+// Every entry is tagged with the tables it reads. Each table has a version counter which is bumped by every write
+// done by DBAssetsInsert, DBAssetsDelete and DBAssetsUpdate functions once it is committed (writes done inside a
+// fty::db::Transaction or a ChangeNotifier::Deferral bump at its commit); an entry is fresh as long as versions of its
+// tables did not change since it was loaded.
+// Entries are kept per database, the database of a connection is queried by its first call only. Queries inside a
+// fty::db::Transaction (or a ChangeNotifier::Deferral) bypass the cache, so they see their own writes and never store
+// uncommitted rows; a bare tntdb::Transaction is not recognised, its writes invalidate entries when they are done.
+// Only writes done by this process are seen, so enable the cache only in processes which own the writes to the
+// cached tables (or can live with results staying stale until the next local write).
+// Disabled by default, enable it by QueryCache::enable(true).
+class QueryCache
+{
+public:
+    enum class Policy
+    {
+        Fresh,               // stale entry is reloaded before returning
+        StaleWhileRevalidate // stale entry is returned and reloaded in background
+    };
+
+    struct Stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t staleHits;
+    };
+
+    // enable: disabling drops all entries and stops the background refresh
+    static void  enable(bool enabled);
+    static bool  enabled();
+    static Stats stats();
+
+    // clear: drop all entries
+    static void clear();
+
+    // bump: increase version of table now, invalidates all entries reading it
+    // write functions use ChangeNotifier::invalidate, which waits for the commit of the innermost Deferral
+    static void bump(const std::string& table);
+
+    // dashboardPolicy: policy used by queries which feed dashboards (Fresh by default)
+    static void   setDashboardPolicy(Policy policy);
+    static Policy dashboardPolicy();
+
+    // get: return cached result for key, or load (and cache) it
+    // load may be called later by the background refresh thread with its own connection to the same database when
+    // the policy is StaleWhileRevalidate, so it must capture everything by value
+    template <typename T>
+    static T get(tntdb::Connection& conn, const std::string& key, const std::vector<std::string>& tables,
+        const std::function<T(tntdb::Connection&)>& load, Policy policy = Policy::Fresh);
+
+    // key: build key from SQL text and bound parameters
+    template <typename... Args>
+    static std::string key(const std::string& sql, const Args&... params);
+
+private:
+    using Loader = std::function<std::any(tntdb::Connection&)>;
+
+    static std::any getAny(tntdb::Connection& conn, const std::string& key, const std::vector<std::string>& tables,
+        const Loader& load, Policy policy);
+};
+
+// =====================================================================================================================
+
+template <typename T>
+inline T QueryCache::get(tntdb::Connection& conn, const std::string& key, const std::vector<std::string>& tables,
+    const std::function<T(tntdb::Connection&)>& load, Policy policy)
+{
+    if (!enabled()) {
+        return load(conn);
+    }
+
+    Loader loader = [load](tntdb::Connection& c) {
+        return std::any(load(c));
+    };
+    return std::any_cast<T>(getAny(conn, key, tables, loader, policy));
+}
+
+template <typename... Args>
+inline std::string QueryCache::key(const std::string& sql, const Args&... params)
+{
+    std::ostringstream out;
+    out << sql;
+    ((out << '\x1f' << params), ...);
+    return out.str();
+}
+
+} // namespace fty::db
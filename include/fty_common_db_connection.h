@@ -5,6 +5,10 @@
 #include <fty/traits.h>
 #include <memory>
 
+namespace tntdb {
+class Connection;
+}
+
 namespace fty::db {
 
 // =====================================================================================================================
@@ -209,10 +213,13 @@ private:
 
 // =====================================================================================================================
 
+// Transaction: transaction whose changes are notified (fty::db::ChangeNotifier) and invalidate QueryCache once it is
+// committed, use it to group calls of the write functions of this library
 class Transaction
 {
 public:
     Transaction(Connection& con);
+    Transaction(tntdb::Connection& con);
     ~Transaction();
 
     void commit();
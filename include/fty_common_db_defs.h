@@ -25,6 +25,8 @@
 #include <functional>
 #include <inttypes.h>
 #include <tntdb.h>
+#include <type_traits>
+#include <utility>
 
 #define INPUT_POWER_CHAIN 1
 
@@ -75,6 +77,22 @@ inline db_reply<T> db_reply_new(T& item)
     return val;
 }
 
+// db_reply_new: reply taking over item, without copying it
+template <typename T, typename = std::enable_if_t<!std::is_lvalue_reference_v<T>>>
+inline db_reply<T> db_reply_new(T&& item)
+{
+    db_reply<T> val;
+    val.status        = 1;
+    val.errtype       = 0;
+    val.errsubtype    = 0;
+    val.rowid         = 0;
+    val.affected_rows = 0;
+    val.msg           = "";
+    val.addinfo       = nullptr;
+    val.item          = std::move(item);
+    return val;
+}
+
 struct db_web_basic_element_t
 {
     uint32_t    id;
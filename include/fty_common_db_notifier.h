@@ -0,0 +1,132 @@
+/*  =========================================================================
+    fty_common_db_notifier - In-process notifications of asset changes
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <tntdb/connect.h>
+#include <utility>
+#include <vector>
+
+namespace fty::db {
+
+struct ChangeEvent
+{
+    enum class Operation
+    {
+        Insert,
+        Update,
+        Delete
+    };
+
+    uint32_t    assetId;   // changed asset, 0 if unknown or if the change is not bound to an asset
+    std::string assetName; // set instead of assetId by functions which identify the asset by name
+    std::string table;     // changed table, e.g. "t_bios_asset_element"
+    Operation   operation;
+};
+
+// ChangeNotifier: tells components of this process about changes done by the write functions of this library
+//
+// Observers are called synchronously in the thread which did the change: changes done inside a Deferral (or
+// fty::db::Transaction) when it is committed, they are dropped when it is not; any other change right after the
+// statement.
+// Group writes in fty::db::Transaction (or in a Deferral committed after the transaction). The library does not ask
+// the server about transactions, so changes done in a bare tntdb::Transaction are announced (and invalidate QueryCache)
+// when they are done, before they are committed.
+// Optionally every event is published on a czmq PUB socket as frames [table, operation, asset id, asset name], so
+// actors can subscribe (by table prefix) without sharing any state.
+class ChangeNotifier
+{
+public:
+    using Observer = std::function<void(const ChangeEvent&)>;
+
+    // subscribe: register observer, returns handle for unsubscribe
+    static uint64_t subscribe(const Observer& observer);
+    static void     unsubscribe(uint64_t handle);
+
+    // startPublisher: bind PUB socket to endpoint (e.g. "inproc://fty-db-changes")
+    // returns 0 if succesful, -1 if error occurs
+    static int  startPublisher(const std::string& endpoint);
+    static void stopPublisher();
+
+    // notify: deliver event now, or queue it in the innermost Deferral of this thread
+    static void notify(const ChangeEvent& event);
+
+    // invalidate: drop results of QueryCache reading table, now or at commit of the innermost Deferral
+    static void invalidate(const std::string& table);
+
+    // deferring: true if a Deferral is active in this thread
+    static bool deferring();
+
+    // journal: write change to the change journal (if enabled, see fty_common_db_asset_journal.h) now, or at prepare of
+    // the innermost Deferral of this thread, so that it is part of the transaction
+    static void journal(tntdb::Connection& conn, const ChangeEvent& event);
+
+    // operationToString: "insert", "update" or "delete"
+    static const char* operationToString(ChangeEvent::Operation operation);
+
+    // Deferral: hold events of this thread until commit, create it before an explicit transaction
+    //     ChangeNotifier::Deferral deferral;
+    //     tntdb::Transaction trans(conn);
+    //     ... write functions ...
+    //     deferral.prepare();
+    //     trans.commit();
+    //     deferral.commit();
+    // fty::db::Transaction does all of it
+    class Deferral
+    {
+    public:
+        Deferral();
+        ~Deferral();
+
+        Deferral(const Deferral&) = delete;
+        Deferral& operator=(const Deferral&) = delete;
+
+        // prepare: write queued changes to the change journal in one batch, before the transaction commits
+        // throws on deadlock and lock wait timeout, the transaction must not be committed then
+        void prepare();
+
+        // commit: invalidate cached results and deliver queued events (or hand them over to the enclosing Deferral)
+        // changes not journaled by prepare are journaled now (outside of the transaction) or by the enclosing Deferral
+        void commit();
+
+        // discard: drop queued events and invalidations, done by destructor too
+        void discard();
+
+    private:
+        friend class ChangeNotifier;
+
+        using JournalEntry = std::pair<tntdb::Connection, ChangeEvent>;
+
+        std::vector<ChangeEvent>  m_events;
+        std::set<std::string>     m_tables;  // to invalidate in QueryCache
+        std::vector<JournalEntry> m_journal; // to write to the change journal
+        Deferral*                 m_previous;
+    };
+
+private:
+    static void deliver(const ChangeEvent& event);
+};
+
+} // namespace fty::db
@@ -0,0 +1,93 @@
+/*  =========================================================================
+    fty_common_db_purge - Throttled background purge of assets
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <tntdb/connect.h>
+#include <vector>
+
+namespace fty::db {
+
+// Purge: delete large amounts of asset data without stalling other agents
+//
+// Assets are queued in t_bios_asset_purge_queue (created by database/mysql/0001_asset_purge_queue.sql, the library
+// runs no DDL) and purged by short autocommit statements deleting at most Options::chunkRows rows each, with a pause
+// after every chunk so that no more than Options::rowsPerSecond rows are deleted per second. An asset leaves the queue
+// once all its data is gone, so a purge interrupted by a restart resumes with the next start() (of any process).
+// Assets which cannot be deleted stay in the queue marked as failed, they are skipped until queued again.
+// Scope::Asset deletes what DBAssetsDelete::delete_assets does; children of purged assets lose their parent.
+class Purge
+{
+public:
+    enum class Scope
+    {
+        ExtAttributes, // all ext attributes of the asset
+        Links,         // power links from and to the asset
+        Asset          // everything referring to the asset, then the asset
+    };
+
+    struct Options
+    {
+        uint32_t chunkRows          = 500;  // rows deleted by one statement
+        uint32_t rowsPerSecond      = 2000; // budget of the background thread
+        uint32_t lockWaitTimeoutSec = 2;    // innodb_lock_wait_timeout of purge statements
+    };
+
+    struct Progress
+    {
+        bool     running;       // background thread is running
+        uint64_t deletedRows;   // rows deleted by purge statements
+        uint64_t chunks;        // number of purge statements which deleted something
+        uint64_t purgedAssets;  // assets which left the queue
+        uint64_t failedAssets;  // assets which could not be deleted (marked as failed in the queue)
+        uint64_t lockTimeouts;  // statements which failed on lock wait timeout or deadlock (retried later)
+        uint64_t lastChunkUsec; // duration of the last statement, mostly lock waits when it grows
+        uint64_t maxChunkUsec;  // the longest statement
+    };
+
+    // enqueue: queue assets for purge, assets marked as failed are retried
+    // returns 0 if succesful, -1 if error occurs (also if the queue table is missing)
+    static int enqueue(tntdb::Connection& conn, const std::vector<uint32_t>& ids, Scope scope);
+
+    // pending: number of queued assets, without the failed ones
+    // returns -1 if error occurs
+    static int64_t pending(tntdb::Connection& conn);
+
+    // failed: number of queued assets which could not be deleted
+    // returns -1 if error occurs
+    static int64_t failed(tntdb::Connection& conn);
+
+    // step: delete at most maxRows rows of queued assets, for callers doing their own scheduling
+    // returns number of deleted rows (at least 1 if some asset left the queue, 0 if nothing is queued),
+    // -1 if error occurs
+    static int64_t step(tntdb::Connection& conn, uint32_t maxRows);
+
+    // start: purge in background thread with its own connection until the queue is empty, then keep watching it
+    // the thread is stopped by stop() or at exit
+    static void start();
+    static void start(const Options& options);
+    static void stop();
+
+    static Progress progress();
+};
+
+} // namespace fty::db
@@ -0,0 +1,182 @@
+/*  =========================================================================
+    fty_common_db_result - Move-only result of a query, convertible to db_reply
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_common_db_defs.h"
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace fty::db {
+
+// Result: value of a query or the reason why it failed
+//
+// Move-only, so a large item (map of ext attributes, vector of elements) is built once and handed over to the caller
+// without any copy:
+//     auto res = DBAssets::read_ext_attributes(conn, id);
+//     if (!res) { log_error("%s", res.error().c_str()); ... }
+//     auto ext = std::move(res).value();
+// toReply() and fromReply() convert from/to db_reply for the functions keeping the old interface.
+template <typename T>
+class Result
+{
+public:
+    // success
+    Result(T&& value);
+
+    // failure
+    static Result failure(int errtype, int errsubtype, const std::string& msg);
+
+    Result(Result&&)            = default;
+    Result& operator=(Result&&) = default;
+    Result(const Result&)       = delete;
+    Result& operator=(const Result&) = delete;
+
+    bool               ok() const;
+    explicit           operator bool() const;
+    int                errtype() const;
+    int                errsubtype() const;
+    const std::string& error() const;
+
+    // value: value of successful result, throws std::logic_error on failure
+    const T& value() const&;
+    T&       value() &;
+    T        value() &&;
+
+    // toReply: move result into db_reply, item is default constructed on failure
+    db_reply<T> toReply() &&;
+
+    // fromReply: move db_reply into result
+    static Result fromReply(db_reply<T>&& reply);
+
+private:
+    Result() = default;
+
+    void check() const;
+
+    std::optional<T> m_value;
+    int              m_errtype    = 0;
+    int              m_errsubtype = 0;
+    std::string      m_msg;
+};
+
+// =====================================================================================================================
+
+template <typename T>
+inline Result<T>::Result(T&& value)
+    : m_value(std::move(value))
+{
+}
+
+template <typename T>
+inline Result<T> Result<T>::failure(int errtype, int errsubtype, const std::string& msg)
+{
+    Result ret;
+    ret.m_errtype    = errtype;
+    ret.m_errsubtype = errsubtype;
+    ret.m_msg        = msg;
+    return ret;
+}
+
+template <typename T>
+inline bool Result<T>::ok() const
+{
+    return m_value.has_value();
+}
+
+template <typename T>
+inline Result<T>::operator bool() const
+{
+    return ok();
+}
+
+template <typename T>
+inline int Result<T>::errtype() const
+{
+    return m_errtype;
+}
+
+template <typename T>
+inline int Result<T>::errsubtype() const
+{
+    return m_errsubtype;
+}
+
+template <typename T>
+inline const std::string& Result<T>::error() const
+{
+    return m_msg;
+}
+
+template <typename T>
+inline void Result<T>::check() const
+{
+    if (!ok()) {
+        throw std::logic_error("value of failed result: " + m_msg);
+    }
+}
+
+template <typename T>
+inline const T& Result<T>::value() const&
+{
+    check();
+    return *m_value;
+}
+
+template <typename T>
+inline T& Result<T>::value() &
+{
+    check();
+    return *m_value;
+}
+
+template <typename T>
+inline T Result<T>::value() &&
+{
+    check();
+    return std::move(*m_value);
+}
+
+template <typename T>
+inline db_reply<T> Result<T>::toReply() &&
+{
+    db_reply<T> ret = db_reply_new(ok() ? std::move(*m_value) : T{});
+    if (!ok()) {
+        ret.status     = 0;
+        ret.errtype    = m_errtype;
+        ret.errsubtype = m_errsubtype;
+        ret.msg        = std::move(m_msg);
+    }
+    return ret;
+}
+
+template <typename T>
+inline Result<T> Result<T>::fromReply(db_reply<T>&& reply)
+{
+    if (reply.status == 0) {
+        return failure(reply.errtype, reply.errsubtype, reply.msg);
+    }
+    return Result(std::move(reply.item));
+}
+
+} // namespace fty::db
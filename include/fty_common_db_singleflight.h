@@ -0,0 +1,128 @@
+/*  =========================================================================
+    fty_common_db_singleflight - Deduplication of identical concurrent queries
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <any>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <tntdb/connect.h>
+
+namespace fty::db {
+
+// SingleFlight: share result of a query between threads requesting it at the same moment
+//
+// While a query identified by key (SQL text + bound parameters) is running, other callers with the same key on the
+// same database wait for it and get a copy of its result (or its exception) instead of running the query again.
+// Callers inside a fty::db::Transaction (or a ChangeNotifier::Deferral) always run the query, so they see their own
+// writes; a bare tntdb::Transaction is not recognised, use fty::db::Transaction for reads which must see them.
+// Nothing is cached: once the query finished, the next call runs it again.
+// The database of a connection is queried by its first call only.
+// Disabled by default, enable it by SingleFlight::enable(true).
+class SingleFlight
+{
+public:
+    struct Stats
+    {
+        uint64_t executed;  // number of queries really run while enabled
+        uint64_t coalesced; // number of calls served by a query run by another thread
+    };
+
+    static void  enable(bool enabled);
+    static bool  enabled();
+    static Stats stats();
+    static void  resetStats();
+
+    // run: run func, or wait for the identical call which is already running
+    template <typename T>
+    static T run(tntdb::Connection& conn, const std::string& key, const std::function<T()>& func);
+
+    // key: build key from SQL text and bound parameters
+    template <typename... Args>
+    static std::string key(const std::string& sql, const Args&... params);
+
+private:
+    struct Call
+    {
+        std::mutex              mutex;
+        std::condition_variable cond;
+        bool                    done = false;
+        std::any                result;
+        std::exception_ptr      error;
+    };
+
+    static std::map<std::string, std::shared_ptr<Call>>& calls();
+    static std::string                                   scope(tntdb::Connection& conn);
+    static std::shared_ptr<Call>                         join(const std::string& key, bool& leader);
+    static void                                          finish(const std::string& key, const std::shared_ptr<Call>& call);
+    static void                                          wait(const std::shared_ptr<Call>& call);
+};
+
+// =====================================================================================================================
+
+template <typename T>
+inline T SingleFlight::run(tntdb::Connection& conn, const std::string& key, const std::function<T()>& func)
+{
+    if (!enabled()) {
+        return func();
+    }
+    std::string prefix = scope(conn);
+    if (prefix.empty()) {
+        return func();
+    }
+
+    std::string full   = prefix + '\x1e' + key;
+    bool        leader = false;
+    auto        call   = join(full, leader);
+    if (leader) {
+        try {
+            call->result = func();
+        } catch (...) {
+            call->error = std::current_exception();
+        }
+        finish(full, call);
+    } else {
+        wait(call);
+    }
+
+    if (call->error) {
+        std::rethrow_exception(call->error);
+    }
+    return std::any_cast<T>(call->result);
+}
+
+template <typename... Args>
+inline std::string SingleFlight::key(const std::string& sql, const Args&... params)
+{
+    std::ostringstream out;
+    out << sql;
+    ((out << '\x1f' << params), ...);
+    return out.str();
+}
+
+} // namespace fty::db
@@ -0,0 +1,65 @@
+/*  =========================================================================
+    fty_common_db_suffix - Allocation of unique asset name suffixes
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <tntdb/connect.h>
+#include <vector>
+
+namespace fty::db {
+
+// SuffixAllocator: unique 8 digit suffixes of internal asset names ("ups-00000123")
+//
+// Suffixes are taken from blocks reserved in t_bios_asset_name_sequence, whose AUTO_INCREMENT id is the number of
+// the block, so processes never get the same block. All blocks needed by one take are reserved at once and checked
+// by one scan against existing names (which may carry random suffixes given by older versions), then their
+// suffixes are handed out without any query.
+// The table is created by the schema migration database/mysql/0004_asset_name_sequence.sql, suffixes left from
+// reserved blocks are kept per database (server and schema).
+// If the sequence table cannot be used or all blocks are gone, random suffixes are probed as before.
+class SuffixAllocator
+{
+public:
+    // number of suffixes in a block, must be the same in all processes sharing the database
+    static constexpr uint32_t BlockSize = 64;
+
+    struct Stats
+    {
+        uint64_t blocks;    // number of blocks reserved by this process
+        uint64_t allocated; // number of suffixes handed out
+        uint64_t probed;    // number of suffixes handed out by the random probe fallback
+    };
+
+    // take: get count unique suffixes
+    // conn is used only to check suffixes against existing names, blocks are reserved on a separate (cached)
+    // connection to the same database so they survive rollback of the transaction of the caller
+    // throws std::runtime_error if no unique suffix can be found
+    static std::vector<std::string> take(tntdb::Connection& conn, size_t count);
+
+    // next: get one unique suffix
+    static std::string next(tntdb::Connection& conn);
+
+    static Stats stats();
+};
+
+} // namespace fty::db
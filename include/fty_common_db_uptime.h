@@ -21,9 +21,17 @@
 
 #pragma once
 
+#include <map>
+#include <string>
+#include <vector>
+
 typedef struct _zhash_t zhash_t;
 namespace DBUptime {
 
 bool get_dc_upses(const char* asset_name, zhash_t* hash);
 
+// get_dcs_upses: active UPSes of every datacenter (key is the datacenter name), in two queries
+// datacenters without UPS have an empty list
+bool get_dcs_upses(std::map<std::string, std::vector<std::string>>& dc_upses);
+
 }
@@ -0,0 +1,75 @@
+/*  =========================================================================
+    fty_common_db_writebehind - Write-behind buffer of read-only ext attributes
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace fty::db {
+
+// ExtAttributeWriteBehind: buffer of read-only ext attributes written every polling cycle by discovery agents
+//
+// Agents queue values by write() instead of DBAssetsInsert::insert_into_asset_ext_attribute, which always writes
+// directly. The last value written per (asset, keytag) is remembered, so a write of an unchanged value is dropped in
+// memory; queued values are coalesced and flushed by a background thread every interval, or as soon as threshold
+// values are queued, with one multi-row upsert per 256 values. If an upsert fails, its values are written one by one
+// and those failing alone are rejected. Values queued at exit are lost unless enable(false) is called before.
+// Values written by other functions of this process (or deleted by them) are forgotten, but changes done by other
+// processes are not seen: enable it only in the process which owns those attributes.
+// Disabled by default, enable it by ExtAttributeWriteBehind::enable(true).
+class ExtAttributeWriteBehind
+{
+public:
+    struct Stats
+    {
+        uint64_t queued;        // writes queued for flush
+        uint64_t dropped;       // writes of a value equal to the stored or queued one
+        uint64_t coalesced;     // queued values replaced by a newer one before flush
+        uint64_t written;       // values written by flushes
+        uint64_t flushes;       // number of successful flushes
+        uint64_t failures;      // number of flushes with an error (values retried one by one, or queued again)
+        uint64_t rejected;      // values dropped as they cannot be written even alone
+        uint64_t lastFlushUsec; // duration of the last flush
+        uint64_t maxFlushUsec;  // the longest flush
+        uint64_t sumFlushUsec;  // total duration of flushes, divide by flushes for the mean
+    };
+
+    // enable: start (or stop, flushing what is queued) the buffer and its flush thread
+    static void enable(bool enabled, std::chrono::milliseconds interval = std::chrono::milliseconds(1000),
+        size_t threshold = 256);
+    static bool enabled();
+
+    // write: queue value of read-only ext attribute
+    // returns false if the buffer is disabled (then nothing was done)
+    static bool write(uint32_t assetId, const std::string& keytag, const std::string& value);
+
+    // flush: write queued values now
+    // returns 0 if succesful, -1 if error occurs
+    static int flush();
+
+    static Stats stats();
+    static void  resetStats();
+};
+
+} // namespace fty::db
@@ -27,6 +27,7 @@
 */
 
 #include "fty_common_db.h"
+#include "fty_common_db_sql.h"
 #include <assert.h>
 #include <fty_common_macros.h>
 #include <fty_log.h>
@@ -368,144 +369,25 @@ int select_asset_element_all_with_warranty_end(tntdb::Connection& conn, std::fun
 }
 
 
-int select_assets_by_container(tntdb::Connection& conn, uint32_t element_id, std::vector<uint16_t> types,
-    std::vector<uint16_t> subtypes, const std::string& without, const std::string& status,
-    const std::string &configured, std::function<void(const tntdb::Row&)> cb)
+// s_select_assets_by_container: select assets from container, whole result if page is nullptr
+static int s_select_assets_by_container(tntdb::Connection& conn, uint32_t element_id, const AssetFilter& filter,
+    const AssetPage* page, std::function<void(const tntdb::Row&)> cb)
 {
     LOG_START;
     log_debug("container element_id = %" PRIu32, element_id);
 
     try {
-        std::string select =
-            " SELECT "
-            "   v.name, "
-            "   v.id_asset_element as asset_id, "
-            "   v.id_asset_device_type as subtype_id, "
-            "   v.type_name as subtype_name, "
-            "   v.id_type as type_id "
-            " FROM "
-            "   v_bios_asset_element_super_parent AS v"
-            " WHERE "
-            "   :containerid in (v.id_parent1, v.id_parent2, v.id_parent3, "
-            "                    v.id_parent4, v.id_parent5, v.id_parent6, "
-            "                    v.id_parent7, v.id_parent8, v.id_parent9, "
-            "                    v.id_parent10)";
-        if (!subtypes.empty()) {
-            std::string list;
-            for (auto& id : subtypes)
-                list += std::to_string(id) + ",";
-            select += " AND v.id_asset_device_type in (" + list.substr(0, list.size() - 1) + ")";
-        }
-        if (!types.empty()) {
-            std::string list;
-            for (auto& id : types)
-                list += std::to_string(id) + ",";
-            select += " AND v.id_type in (" + list.substr(0, list.size() - 1) + ")";
-        }
-        if (status != "") {
-            select += " AND v.status = \"" + status + "\"";
+        AssetFilter::Plan plan = filter.compile(AssetFilter::Scope::Container);
+        if (page) {
+            plan.sql += page->sql("v.id_asset_element", "v.name", !plan.where);
         }
 
-        std::string end_select = "";
-        if (without != "") {
-            if (without == "location") {
-                select += " AND v.id_parent1 is NULL ";
-            } else if (without == "powerchain") {
-                end_select +=
-                    " AND NOT EXISTS "
-                    " (SELECT id_asset_device_dest "
-                    "  FROM t_bios_asset_link_type as l JOIN t_bios_asset_link as a"
-                    "  ON a.id_asset_link_type=l.id_asset_link_type "
-                    "  WHERE "
-                    "     name=\"power chain\" "
-                    "     AND v.id_asset_element=a.id_asset_device_dest)";
-            } else {
-                end_select +=
-                    " AND NOT EXISTS "
-                    " (SELECT a.id_asset_element "
-                    "  FROM "
-                    "     t_bios_asset_ext_attributes as a "
-                    "  WHERE "
-                    "     a.keytag=\"" +
-                    without +
-                    "\""
-                    "     AND v.id_asset_element = a.id_asset_element)";
-            }
-        }
-
-        // if configured option is defined
-        if (!configured.empty()) {
-            std::string sensor_sub_id = std::to_string(persist::asset_subtype::SENSOR);
-            std::ostringstream ss;
-            ss << persist::asset_subtype::UPS << "," << persist::asset_subtype::PDU << ","
-               << persist::asset_subtype::EPDU << "," << persist::asset_subtype::STS << ","
-               << persist::asset_subtype::SERVER << "," << persist::asset_subtype::STORAGE << ","
-               << persist::asset_subtype::PATCHPANEL << "," << persist::asset_subtype::SWITCH << ","
-               << persist::asset_subtype::ROUTER << "," << persist::asset_subtype::APPLIANCE << ","
-               << persist::asset_subtype::CHASSIS << "," << persist::asset_subtype::OTHER << ","
-               << persist::asset_subtype::PCU;
-            std::string powerchain_sublist_id = ss.str();
-            ss.str(""); ss.clear();
-            ss << persist::asset_type::ROOM << "," << persist::asset_type::ROW << ","
-               << persist::asset_type::RACK << "," << persist::asset_type::DEVICE;
-            std::string filter_type_id = ss.str();
-            ss.str(""); ss.clear();
-            ss << persist::asset_subtype::SENSOR << "," << persist::asset_subtype::VM << ","
-               << persist::asset_subtype::VIRTUAL << "," << persist::asset_subtype::RACKCONTROLLER;
-            std::string filter_subtype_id = ss.str();
-
-            // search all device which are not configured
-            if (configured == "no") {
-                end_select +=
-                    // if sensor device, parent 1 or parent 2 not configured
-                    " AND ((((v.id_asset_device_type = " + sensor_sub_id + ") "
-                    "     AND (v.id_parent1 IS NULL "
-                    "     OR v.id_parent2 IS NULL))) "
-                    // else if device with power chain, parent not defined or power chain not defined
-                    " OR (v.id_asset_device_type IN (" + powerchain_sublist_id + ") "
-                    "     AND (v.id_parent1 IS NULL "
-                    "         OR NOT EXISTS "
-                    "             (SELECT id_asset_device_dest FROM t_bios_asset_link_type AS l"
-                    "             JOIN t_bios_asset_link AS a ON a.id_asset_link_type=l.id_asset_link_type "
-                    "             WHERE name=\"power chain\" AND v.id_asset_element=a.id_asset_device_dest))) "
-                    // else for other device with no power chain, parent not defined
-                    " OR (v.id_type IN (" + filter_type_id + ") "
-                    "     AND v.id_asset_device_type NOT IN (" + filter_subtype_id + ") "
-                    "     AND v.id_parent1 IS NULL)) ";
-
-            // search all device which are configured
-            } else if (configured == "yes") {
-                end_select +=
-                    // if device sensor, parent 1 and parent 2 must be configured
-                    " AND ((((v.id_asset_device_type = " + sensor_sub_id + ") "
-                    "     AND v.id_parent1 IS NOT NULL "
-                    "     AND v.id_parent2 IS NOT NULL)) "
-                    // else if device with power chain, parent and power chain must be defined
-                    " OR (v.id_asset_device_type IN (" + powerchain_sublist_id + ") "
-                    "     AND "
-                    "         (v.id_parent1 IS NOT NULL "
-                    "         AND EXISTS "
-                    "             (SELECT id_asset_device_dest FROM t_bios_asset_link_type AS l"
-                    "             JOIN t_bios_asset_link AS a ON a.id_asset_link_type=l.id_asset_link_type "
-                    "             WHERE name=\"power chain\" AND v.id_asset_element=a.id_asset_device_dest))) "
-                    // else for other device with no power chain, parent must be defined
-                    " OR (v.id_type IN (" + filter_type_id + ") "
-                    "     AND v.id_asset_device_type NOT IN (" + filter_subtype_id + ") "
-                    "     AND v.id_parent1 IS NOT NULL)) ";
-            }
-            // search all device which are configured and no configured
-            else if (configured == "all") {
-                // note: the value "all" deactivate the option
-            }
-            else {
-               log_error("bad value for configured option: %s (no, yes or all)", configured.c_str());
-            }
-        }
-
-        select += end_select;
-
         // Can return more than one row.
-        tntdb::Statement st = conn.prepareCached(select);
+        tntdb::Statement st = conn.prepareCached(plan.sql);
+        plan.bind(st);
+        if (page) {
+            page->bind(st);
+        }
 
         tntdb::Result result = st.set("containerid", element_id).select();
         log_debug("[v_bios_asset_element_super_parent]: were selected %" PRIu32 " rows", result.size());
@@ -520,6 +402,58 @@ int select_assets_by_container(tntdb::Connection& conn, uint32_t element_id, std
     }
 }
 
+int select_assets_by_container(
+    tntdb::Connection& conn, uint32_t element_id, const AssetFilter& filter, std::function<void(const tntdb::Row&)> cb)
+{
+    return s_select_assets_by_container(conn, element_id, filter, nullptr, cb);
+}
+
+int select_assets_by_container(tntdb::Connection& conn, uint32_t element_id, const AssetFilter& filter,
+    const AssetPage& page, std::function<void(const tntdb::Row&)> cb)
+{
+    return s_select_assets_by_container(conn, element_id, filter, &page, cb);
+}
+
+int select_assets_by_containers(tntdb::Connection& conn, const std::vector<uint32_t>& container_ids,
+    const AssetFilter& filter, std::function<void(uint32_t, const tntdb::Row&)> cb)
+{
+    LOG_START;
+
+    try {
+        for (size_t offset = 0; offset < container_ids.size(); offset += DBSql::CHUNK_SIZE) {
+            size_t                end = std::min(container_ids.size(), offset + DBSql::CHUNK_SIZE);
+            std::vector<uint32_t> chunk(container_ids.begin() + long(offset), container_ids.begin() + long(end));
+
+            AssetFilter::Plan plan = filter.compile(chunk);
+
+            // Can return more than one row per container.
+            tntdb::Statement st = conn.prepareCached(plan.sql);
+            plan.bind(st);
+
+            tntdb::Result result = st.select();
+            log_debug("[v_bios_asset_element_super_parent]: were selected %" PRIu32 " rows", result.size());
+            for (auto& row : result) {
+                uint32_t container_id = 0;
+                row["container_id"].get(container_id);
+                cb(container_id, row);
+            }
+        }
+        LOG_END;
+        return 0;
+    } catch (const std::exception& e) {
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
+int select_assets_by_container(tntdb::Connection& conn, uint32_t element_id, std::vector<uint16_t> types,
+    std::vector<uint16_t> subtypes, const std::string& without, const std::string& status,
+    const std::string &configured, std::function<void(const tntdb::Row&)> cb)
+{
+    return select_assets_by_container(
+        conn, element_id, AssetFilter{types, subtypes, status, without, configured}, cb);
+}
+
 int select_assets_by_container(tntdb::Connection& conn, uint32_t element_id, std::vector<uint16_t> types,
     std::vector<uint16_t> subtypes, const std::string& without, const std::string& status,
     std::function<void(const tntdb::Row&)> cb)
@@ -646,16 +580,22 @@ int select_assets_by_container_name_filter(tntdb::Connection& conn, const std::s
             request += " AND ( " + select_assets_by_container_filter(filter) + ")";
         log_debug("[v_bios_asset_element_super_parent]: %s", request.c_str());
 
-        // Can return more than one row.
-        tntdb::Statement select_data = conn.prepareCached(request);
-
-        tntdb::Result result = select_data.set("containerid", id).select();
-        log_debug("[v_bios_asset_element_super_parent]: were selected %" PRIu32 " rows", result.size());
-        for (auto& row : result) {
-            std::string name;
-            row["name"].get(name);
-            assets.push_back(name);
-        }
+        std::function<std::vector<std::string>()> func = [&]() {
+            // Can return more than one row.
+            tntdb::Statement select_data = conn.prepareCached(request);
+
+            tntdb::Result result = select_data.set("containerid", id).select();
+            log_debug("[v_bios_asset_element_super_parent]: were selected %" PRIu32 " rows", result.size());
+            std::vector<std::string> names;
+            for (auto& row : result) {
+                std::string name;
+                row["name"].get(name);
+                names.push_back(name);
+            }
+            return names;
+        };
+        auto names = fty::db::SingleFlight::run(conn, fty::db::SingleFlight::key(request, id), func);
+        assets.insert(assets.end(), names.begin(), names.end());
         return 0;
     } catch (const std::exception& e) {
         log_error("Error: ", e.what());
@@ -680,15 +620,22 @@ int select_assets_by_filter(
         if (!types_and_subtypes.empty())
             request += " WHERE " + select_assets_by_container_filter(types_and_subtypes);
         log_debug("[v_bios_asset_element_super_parent]: %s", request.c_str());
-        // Can return more than one row.
-        tntdb::Statement st     = conn.prepareCached(request);
-        tntdb::Result    result = st.select();
-        log_debug("[v_bios_asset_element_super_parent]: were selected %" PRIu32 " rows", result.size());
-        for (auto& row : result) {
-            std::string name;
-            row["name"].get(name);
-            assets.push_back(name);
-        }
+
+        std::function<std::vector<std::string>()> func = [&]() {
+            // Can return more than one row.
+            tntdb::Statement st     = conn.prepareCached(request);
+            tntdb::Result    result = st.select();
+            log_debug("[v_bios_asset_element_super_parent]: were selected %" PRIu32 " rows", result.size());
+            std::vector<std::string> names;
+            for (auto& row : result) {
+                std::string name;
+                row["name"].get(name);
+                names.push_back(name);
+            }
+            return names;
+        };
+        auto names = fty::db::SingleFlight::run(conn, fty::db::SingleFlight::key(request), func);
+        assets.insert(assets.end(), names.begin(), names.end());
         return 0;
     } catch (const std::exception& e) {
         log_error("Error: ", e.what());
@@ -740,160 +687,24 @@ int select_assets_without_container(tntdb::Connection& conn, std::vector<uint16_
     }
 }
 
-int select_assets_all_container(tntdb::Connection& conn, std::vector<uint16_t> types, std::vector<uint16_t> subtypes,
-    const std::string& without, const std::string& status, const std::string& configured,
+// s_select_assets_all_container: select all assets, whole result if page is nullptr
+static int s_select_assets_all_container(tntdb::Connection& conn, const AssetFilter& filter, const AssetPage* page,
     std::function<void(const tntdb::Row&)> cb)
 {
     LOG_START;
 
     try {
-        std::string select =
-            " SELECT "
-            "   t.name, "
-            "   t.id_asset_element as asset_id, "
-            "   t.id_type as type_id, "
-            "   t.id_subtype as subtype_id "
-            " FROM "
-            "   t_bios_asset_element as t";
-
-        if (!subtypes.empty() || !types.empty() || status != "" || without != "" || !configured.empty()) {
-            select += " WHERE ";
-        }
-        if (!subtypes.empty()) {
-            std::string list;
-            for (auto& id : subtypes)
-                list += std::to_string(id) + ",";
-            select += " t.id_subtype in (" + list.substr(0, list.size() - 1) + ")";
-        }
-        if (!types.empty()) {
-            if (!subtypes.empty()) {
-                select += " AND ";
-            }
-            std::string list;
-            for (auto& id : types)
-                list += std::to_string(id) + ",";
-            select += " t.id_type in (" + list.substr(0, list.size() - 1) + ")";
-        }
-        if (status != "") {
-            if (!subtypes.empty() || !types.empty()) {
-                select += " AND ";
-            }
-            select += " t.status = \"" + status + "\"";
+        AssetFilter::Plan plan = filter.compile(AssetFilter::Scope::All);
+        if (page) {
+            plan.sql += page->sql("t.id_asset_element", "t.name", !plan.where);
         }
 
-        std::string end_select = "";
-        if (without != "") {
-            if (!subtypes.empty() || !types.empty() || status != "") {
-                select += " AND ";
-            }
-            if (without == "location") {
-                select += " t.id_parent is NULL ";
-            } else if (without == "powerchain") {
-                end_select +=
-                    " NOT EXISTS "
-                    " (SELECT id_asset_device_dest "
-                    "  FROM t_bios_asset_link_type as l JOIN t_bios_asset_link as a"
-                    "  ON a.id_asset_link_type=l.id_asset_link_type "
-                    "  WHERE "
-                    "     name=\"power chain\" "
-                    "     AND t.id_asset_element=a.id_asset_device_dest)";
-            } else {
-                end_select +=
-                    " NOT EXISTS "
-                    " (SELECT a.id_asset_element "
-                    "  FROM "
-                    "     t_bios_asset_ext_attributes as a "
-                    "  WHERE "
-                    "     a.keytag=\"" +
-                    without +
-                    "\""
-                    "     AND t.id_asset_element = a.id_asset_element)";
-            }
-        }
-
-        // if configured option is defined
-        if (!configured.empty()) {
-            std::string sensor_sub_id = std::to_string(persist::asset_subtype::SENSOR);
-            std::ostringstream ss;
-            ss << persist::asset_subtype::UPS << "," << persist::asset_subtype::PDU << ","
-               << persist::asset_subtype::EPDU << "," << persist::asset_subtype::STS << ","
-               << persist::asset_subtype::SERVER << "," << persist::asset_subtype::STORAGE << ","
-               << persist::asset_subtype::PATCHPANEL << "," << persist::asset_subtype::SWITCH << ","
-               << persist::asset_subtype::ROUTER << "," << persist::asset_subtype::APPLIANCE << ","
-               << persist::asset_subtype::CHASSIS << "," << persist::asset_subtype::OTHER << ","
-               << persist::asset_subtype::PCU;
-            std::string powerchain_sublist_id = ss.str();
-            ss.str(""); ss.clear();
-            ss << persist::asset_type::ROOM << "," << persist::asset_type::ROW << ","
-               << persist::asset_type::RACK << "," << persist::asset_type::DEVICE;
-            std::string filter_type_id = ss.str();
-            ss.str(""); ss.clear();
-            ss << persist::asset_subtype::SENSOR << "," << persist::asset_subtype::VM << ","
-               << persist::asset_subtype::VIRTUAL << "," << persist::asset_subtype::RACKCONTROLLER;
-            std::string filter_subtype_id = ss.str();
-
-            // search all device which are not configured
-            if(configured == "no") {
-                if (!subtypes.empty() || !types.empty() || status != "" || without != "") {
-                    select += " AND ";
-                }
-                end_select +=
-                    // if device sensor, parent 1 or parent 2 not configured
-                    " (((t.id_subtype = " + sensor_sub_id + ") "
-                    "     AND NOT EXISTS "
-                    "         (SELECT * FROM v_bios_asset_element_super_parent AS v WHERE t.id_asset_element=v.id_asset_element "
-                    "         AND v.id_parent1 IS NOT NULL "
-                    "         AND v.id_parent2 IS NOT NULL)) "
-                    // else if device with power chain, parent not defined or power chain not defined
-                    " OR (t.id_subtype IN (" + powerchain_sublist_id + ") "
-                    "     AND "
-                    "         (t.id_parent IS NULL "
-                    "         OR NOT EXISTS "
-                    "             (SELECT id_asset_device_dest FROM t_bios_asset_link_type AS l"
-                    "             JOIN t_bios_asset_link AS a ON a.id_asset_link_type=l.id_asset_link_type "
-                    "             WHERE name=\"power chain\" AND t.id_asset_element=a.id_asset_device_dest))) "
-                    // else for other device with no power chain, parent not defined
-                    " OR (t.id_type IN (" + filter_type_id + ") "
-                    "     AND t.id_subtype NOT IN (" + filter_subtype_id + ") "
-                    "     AND t.id_parent IS NULL)) ";
-
-            // search all device which are configured
-            } else if (configured == "yes") {
-                if (!subtypes.empty() || !types.empty() || status != "" || without != "") {
-                    select += " AND ";
-                }
-                end_select +=
-                    // if device sensor, parent 1 and parent 2 must be configured
-                    " (((t.id_subtype = " + sensor_sub_id + ") "
-                    "     AND EXISTS "
-                    "         (SELECT * FROM v_bios_asset_element_super_parent AS v WHERE t.id_asset_element=v.id_asset_element "
-                    "         AND v.id_parent1 IS NOT NULL "
-                    "         AND v.id_parent2 IS NOT NULL)) "
-                    // else if device with power chain, parent and power chain must be defined
-                    " OR (t.id_subtype IN (" + powerchain_sublist_id + ") "
-                    "     AND (t.id_parent IS NOT NULL "
-                    "     AND EXISTS "
-                    "         (SELECT id_asset_device_dest FROM t_bios_asset_link_type AS l"
-                    "         JOIN t_bios_asset_link AS a ON a.id_asset_link_type=l.id_asset_link_type "
-                    "         WHERE name=\"power chain\" AND t.id_asset_element=a.id_asset_device_dest))) "
-                    // else for other device with no power chain, parent must be defined
-                    " OR (t.id_type IN (" + filter_type_id + ") "
-                    "     AND t.id_subtype NOT IN (" + filter_subtype_id + ") "
-                    "     AND t.id_parent IS NOT NULL)) ";
-            }
-            // search all device which are configured and no configured
-            else if (configured == "all") {
-                // note: the value "all" deactivate the option
-            }
-            else {
-               log_error("bad value for configured option: %s (no, yes or all)", configured.c_str());
-            }
-        }
-
-        select += end_select;
-
         // Can return more than one row.
-        tntdb::Statement st = conn.prepareCached(select);
+        tntdb::Statement st = conn.prepareCached(plan.sql);
+        plan.bind(st);
+        if (page) {
+            page->bind(st);
+        }
 
         tntdb::Result result = st.select();
         log_debug("[t_bios_asset_element]: were selected %" PRIu32 " rows", result.size());
@@ -908,40 +719,145 @@ int select_assets_all_container(tntdb::Connection& conn, std::vector<uint16_t> t
     }
 }
 
+int select_assets_all_container(
+    tntdb::Connection& conn, const AssetFilter& filter, std::function<void(const tntdb::Row&)> cb)
+{
+    return s_select_assets_all_container(conn, filter, nullptr, cb);
+}
+
+int select_assets_all_container(tntdb::Connection& conn, const AssetFilter& filter, const AssetPage& page,
+    std::function<void(const tntdb::Row&)> cb)
+{
+    return s_select_assets_all_container(conn, filter, &page, cb);
+}
+
+int select_assets_all_container(tntdb::Connection& conn, std::vector<uint16_t> types, std::vector<uint16_t> subtypes,
+    const std::string& without, const std::string& status, const std::string& configured,
+    std::function<void(const tntdb::Row&)> cb)
+{
+    return select_assets_all_container(conn, AssetFilter{types, subtypes, status, without, configured}, cb);
+}
+
 int select_assets_all_container(tntdb::Connection& conn, std::vector<uint16_t> types, std::vector<uint16_t> subtypes,
     const std::string& without, const std::string& status, std::function<void(const tntdb::Row&)> cb)
 {
     return select_assets_all_container(conn, types, subtypes, without, status, "", cb);
 }
 
+// s_count_assets: run count statement compiled from filter, element_id is bound for the container scope
+static int64_t s_count_assets(
+    tntdb::Connection& conn, AssetFilter::Scope scope, uint32_t element_id, const AssetFilter& filter)
+{
+    LOG_START;
+
+    try {
+        AssetFilter::Plan plan = filter.compile(scope, AssetFilter::Aggregate::Count);
+
+        tntdb::Statement st = conn.prepareCached(plan.sql);
+        plan.bind(st);
+        if (scope == AssetFilter::Scope::Container) {
+            st.set("containerid", element_id);
+        }
+
+        uint64_t count = 0;
+        st.selectValue().get(count);
+        LOG_END;
+        return int64_t(count);
+    } catch (const std::exception& e) {
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
+// s_count_assets_grouped: run grouped count statement compiled from filter, key by type/subtype name or status
+static int s_count_assets_grouped(tntdb::Connection& conn, AssetFilter::Scope scope, uint32_t element_id,
+    const AssetFilter& filter, AssetFilter::Aggregate group, std::map<std::string, uint64_t>& counts)
+{
+    LOG_START;
+
+    if (group != AssetFilter::Aggregate::Type && group != AssetFilter::Aggregate::Subtype &&
+        group != AssetFilter::Aggregate::Status) {
+        log_error("assets can be grouped by type, subtype or status only");
+        return -1;
+    }
+
+    try {
+        AssetFilter::Plan plan = filter.compile(scope, group);
+
+        tntdb::Statement st = conn.prepareCached(plan.sql);
+        plan.bind(st);
+        if (scope == AssetFilter::Scope::Container) {
+            st.set("containerid", element_id);
+        }
+
+        counts.clear();
+        for (const auto& row : st.select()) {
+            std::string key;
+            if (group == AssetFilter::Aggregate::Status) {
+                row[0].get(key);
+            } else {
+                uint16_t id = 0;
+                row[0].get(id);
+                key = group == AssetFilter::Aggregate::Type ? persist::typeid_to_type(id)
+                                                            : persist::subtypeid_to_subtype(id);
+            }
+            uint64_t count = 0;
+            row[1].get(count);
+            counts[key] += count;
+        }
+        LOG_END;
+        return 0;
+    } catch (const std::exception& e) {
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
+int64_t count_assets_by_container(tntdb::Connection& conn, uint32_t element_id, const AssetFilter& filter)
+{
+    return s_count_assets(conn, AssetFilter::Scope::Container, element_id, filter);
+}
+
+int count_assets_by_container(tntdb::Connection& conn, uint32_t element_id, const AssetFilter& filter,
+    AssetFilter::Aggregate group, std::map<std::string, uint64_t>& counts)
+{
+    return s_count_assets_grouped(conn, AssetFilter::Scope::Container, element_id, filter, group, counts);
+}
+
+int64_t count_assets_all_container(tntdb::Connection& conn, const AssetFilter& filter)
+{
+    return s_count_assets(conn, AssetFilter::Scope::All, 0, filter);
+}
+
+int count_assets_all_container(tntdb::Connection& conn, const AssetFilter& filter, AssetFilter::Aggregate group,
+    std::map<std::string, uint64_t>& counts)
+{
+    return s_count_assets_grouped(conn, AssetFilter::Scope::All, 0, filter, group, counts);
+}
+
 int select_asset_element_by_dc(tntdb::Connection& conn, int64_t dc_id, std::function<void(const tntdb::Row&)> cb)
 {
     LOG_START;
 
     try {
-        // use nested SELECT instead of three-table JOIN
-        std::string st =
-            "SELECT "
+        // The former form "v.id IN (SELECT ... FROM v_bios_asset_element_super_parent ...)" crashed MySQL when
+        // the prepared statement was executed again (subquery over views is re-optimised on every execution).
+        // A plain JOIN has no subquery to transform, so the statement can be cached. Every asset has exactly one
+        // row in v_bios_asset_element_super_parent, so the JOIN does not duplicate rows.
+        tntdb::Statement select_data = conn.prepareCached(
+            " SELECT "
             "   v.id, v.name, v.type_name, "
             "   v.subtype_name, v.id_parent, "
             "   v.status, v.priority, "
             "   v.asset_tag "
             " FROM "
-            "   v_web_element v "
-            "WHERE "
-            "   v.id in "
-            "   ( "
-            " SELECT p.id_asset_element "
-            " FROM v_bios_asset_element_super_parent p "
+            "   v_bios_asset_element_super_parent p "
+            "   JOIN v_web_element v ON v.id = p.id_asset_element "
             " WHERE "
             "   :containerid in ( p.id_asset_element, p.id_parent1, p.id_parent2, "
             "                     p.id_parent3, p.id_parent4, p.id_parent5, "
             "                     p.id_parent6, p.id_parent7, p.id_parent8, "
-            "                     p.id_parent9, p.id_parent10) "
-            "   ) ";
-
-        // DO NOT CACHE THIS! It will crash MySQL
-        tntdb::Statement select_data = conn.prepare(st);
+            "                     p.id_parent9, p.id_parent10) ");
 
         tntdb::Result result = select_data.set("containerid", dc_id).select();
 
@@ -956,19 +872,43 @@ int select_asset_element_by_dc(tntdb::Connection& conn, int64_t dc_id, std::func
     }
 }
 
+static const std::string asset_element_all_QUERY =
+    " SELECT"
+    "   v.id, v.name, v.type_name,"
+    "   v.subtype_name, v.id_parent, v.id_parent_type,"
+    "   v.status, v.priority,"
+    "   v.asset_tag"
+    " FROM"
+    "   v_web_element v";
+
 int select_asset_element_all(tntdb::Connection& conn, std::function<void(const tntdb::Row&)>& cb)
 {
     LOG_START;
 
     try {
-        tntdb::Statement st = conn.prepareCached(
-            " SELECT"
-            "   v.id, v.name, v.type_name,"
-            "   v.subtype_name, v.id_parent, v.id_parent_type,"
-            "   v.status, v.priority,"
-            "   v.asset_tag"
-            " FROM"
-            "   v_web_element v");
+        tntdb::Statement st = conn.prepareCached(asset_element_all_QUERY);
+
+        tntdb::Result res = st.select();
+
+        for (const auto& r : res) {
+            cb(r);
+        }
+        LOG_END;
+        return 0;
+    } catch (const std::exception& e) {
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
+int select_asset_element_all(
+    tntdb::Connection& conn, const AssetPage& page, std::function<void(const tntdb::Row&)>& cb)
+{
+    LOG_START;
+
+    try {
+        tntdb::Statement st = conn.prepareCached(asset_element_all_QUERY + page.sql("v.id", "v.name", true));
+        page.bind(st);
 
         tntdb::Result res = st.select();
 
@@ -1094,18 +1034,24 @@ int max_number_of_power_links(tntdb::Connection& conn)
 {
     LOG_START;
 
-    try {
-        tntdb::Statement st = conn.prepareCached(
-            " SELECT "
-            "   MAX(power_src_count) "
-            " FROM "
-            "   ( SELECT COUNT(*) power_src_count FROM t_bios_asset_link "
-            "            GROUP BY id_asset_device_dest) pwr ");
+    static const std::string query =
+        " SELECT "
+        "   MAX(power_src_count) "
+        " FROM "
+        "   ( SELECT COUNT(*) power_src_count FROM t_bios_asset_link "
+        "            GROUP BY id_asset_device_dest) pwr ";
 
-        tntdb::Row row = st.selectRow();
+    std::function<int(tntdb::Connection&)> load = [](tntdb::Connection& c) {
+        tntdb::Row row = c.prepareCached(query).selectRow();
 
         int r = 0;
         row[0].get(r);
+        return r;
+    };
+
+    try {
+        int r = fty::db::QueryCache::get(
+            conn, query, {"t_bios_asset_link"}, load, fty::db::QueryCache::dashboardPolicy());
         LOG_END;
         return r;
     } catch (const std::exception& e) {
@@ -1142,18 +1088,24 @@ int max_number_of_asset_groups(tntdb::Connection& conn)
 {
     LOG_START;
 
-    try {
-        tntdb::Statement st = conn.prepareCached(
-            " SELECT "
-            "   MAX(grp_count) "
-            " FROM "
-            "   ( SELECT COUNT(*) grp_count FROM t_bios_asset_group_relation "
-            "            GROUP BY id_asset_element) elmnt_grp ");
+    static const std::string query =
+        " SELECT "
+        "   MAX(grp_count) "
+        " FROM "
+        "   ( SELECT COUNT(*) grp_count FROM t_bios_asset_group_relation "
+        "            GROUP BY id_asset_element) elmnt_grp ";
 
-        tntdb::Row row = st.selectRow();
+    std::function<int(tntdb::Connection&)> load = [](tntdb::Connection& c) {
+        tntdb::Row row = c.prepareCached(query).selectRow();
 
         int r = 0;
         row[0].get(r);
+        return r;
+    };
+
+    try {
+        int r = fty::db::QueryCache::get(
+            conn, query, {"t_bios_asset_group_relation"}, load, fty::db::QueryCache::dashboardPolicy());
         LOG_END;
         return r;
     } catch (const std::exception& e) {
@@ -1258,18 +1210,20 @@ int select_asset_ext_attribute_by_keytag(tntdb::Connection& conn, const std::str
     }
 }
 
+static const std::string ext_rw_attributes_keytags_QUERY =
+    " SELECT"
+    "   DISTINCT(keytag)"
+    " FROM"
+    "   v_bios_asset_ext_attributes"
+    " WHERE "
+    "   read_only = 0"
+    " ORDER BY keytag ";
+
 int select_ext_rw_attributes_keytags(tntdb::Connection& conn, std::function<void(const tntdb::Row&)>& cb)
 {
     LOG_START;
     try {
-        tntdb::Statement st = conn.prepareCached(
-            " SELECT"
-            "   DISTINCT(keytag)"
-            " FROM"
-            "   v_bios_asset_ext_attributes"
-            " WHERE "
-            "   read_only = 0"
-            " ORDER BY keytag ");
+        tntdb::Statement st = conn.prepareCached(ext_rw_attributes_keytags_QUERY);
 
         tntdb::Result res = st.select();
 
@@ -1284,6 +1238,33 @@ int select_ext_rw_attributes_keytags(tntdb::Connection& conn, std::function<void
     }
 }
 
+int select_ext_rw_attributes_keytags(tntdb::Connection& conn, std::vector<std::string>& keytags)
+{
+    LOG_START;
+
+    std::function<std::vector<std::string>(tntdb::Connection&)> load = [](tntdb::Connection& c) {
+        tntdb::Result res = c.prepareCached(ext_rw_attributes_keytags_QUERY).select();
+
+        std::vector<std::string> out;
+        for (const auto& r : res) {
+            std::string keytag;
+            r[0].get(keytag);
+            out.push_back(keytag);
+        }
+        return out;
+    };
+
+    try {
+        keytags = fty::db::QueryCache::get(
+            conn, ext_rw_attributes_keytags_QUERY, {"t_bios_asset_ext_attributes"}, load);
+        LOG_END;
+        return 0;
+    } catch (const std::exception& e) {
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
 int select_ext_attributes_cb(tntdb::Connection& conn, uint32_t asset_id, std::function<void(const tntdb::Row&)> cb)
 {
     try {
@@ -1337,21 +1318,23 @@ int select_asset_element_basic_cb(
     }
 }
 
+static const std::string assets_cb_QUERY =
+    " SELECT "
+    "   v.name, "
+    "   v.id,  "
+    "   v.id_type,  "
+    "   v.id_subtype,  "
+    "   v.id_parent,  "
+    "   v.parent_name,  "
+    "   v.status,  "
+    "   v.priority,  "
+    "   v.asset_tag  "
+    " FROM v_bios_asset_element v ";
+
 int select_assets_cb(tntdb::Connection& conn, std::function<void(const tntdb::Row&)> cb)
 {
     try {
-        tntdb::Statement st = conn.prepareCached(
-            " SELECT "
-            "   v.name, "
-            "   v.id,  "
-            "   v.id_type,  "
-            "   v.id_subtype,  "
-            "   v.id_parent,  "
-            "   v.parent_name,  "
-            "   v.status,  "
-            "   v.priority,  "
-            "   v.asset_tag  "
-            " FROM v_bios_asset_element v ");
+        tntdb::Statement st = conn.prepareCached(assets_cb_QUERY);
 
         tntdb::Result res = st.select();
         log_debug("[v_bios_asset_element]: were selected %zu rows", res.size());
@@ -1369,6 +1352,25 @@ int select_assets_cb(tntdb::Connection& conn, std::function<void(const tntdb::Ro
     }
 }
 
+int select_assets_cb(tntdb::Connection& conn, const AssetPage& page, std::function<void(const tntdb::Row&)> cb)
+{
+    try {
+        tntdb::Statement st = conn.prepareCached(assets_cb_QUERY + page.sql("v.id", "v.name", true));
+        page.bind(st);
+
+        tntdb::Result res = st.select();
+        log_debug("[v_bios_asset_element]: were selected %zu rows", res.size());
+
+        for (const auto& r : res) {
+            cb(r);
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        log_error("[v_bios_asset_element]: error '%s'", e.what());
+        return -1;
+    }
+}
+
 // TODO: this function is probably not necessary, refactor and remove
 db_reply_t select_monitor_device_type_id(tntdb::Connection& conn, const char* device_type_name)
 {
@@ -1517,14 +1519,21 @@ db_reply<db_web_basic_element_t> select_asset_element_web_byName(tntdb::Connecti
     }
 }
 
-db_reply<std::map<std::string, std::pair<std::string, bool>>> select_ext_attributes(
+fty::db::Result<std::map<std::string, std::pair<std::string, bool>>> read_ext_attributes(
     tntdb::Connection& conn, uint32_t element_id)
 {
     LOG_START;
     log_debug("element_id = %" PRIi32, element_id);
 
-    std::map<std::string, std::pair<std::string, bool>>           item{};
-    db_reply<std::map<std::string, std::pair<std::string, bool>>> ret = db_reply_new(item);
+    std::map<std::string, std::pair<std::string, bool>> item;
+
+    if (auto batch = BatchScope::current()) {
+        if (batch->ext_attributes(conn, element_id, item)) {
+            LOG_END;
+            return item;
+        }
+    }
+
     try {
         // Can return more than one row
         tntdb::Statement st_extattr = conn.prepareCached(
@@ -1545,41 +1554,40 @@ db_reply<std::map<std::string, std::pair<std::string, bool>>> select_ext_attribu
             row[1].get(value);
             int read_only = 0;
             row[2].get(read_only);
-            ret.item.insert(std::pair<std::string, std::pair<std::string, bool>>(
-                keytag, std::pair<std::string, bool>(value, read_only ? true : false)));
+            item.emplace_hint(item.end(), std::move(keytag), std::make_pair(std::move(value), read_only != 0));
         }
-        ret.status = 1;
         LOG_END;
-        return ret;
+        return item;
     } catch (const std::exception& e) {
-        ret.status     = 0;
-        ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_INTERNAL;
-        ret.msg        = e.what();
-        ret.item.clear();
         LOG_END_ABNORMAL(e);
-        return ret;
+        return fty::db::Result<std::map<std::string, std::pair<std::string, bool>>>::failure(
+            DB_ERR, DB_ERROR_INTERNAL, e.what());
     }
 }
 
+db_reply<std::map<std::string, std::pair<std::string, bool>>> select_ext_attributes(
+    tntdb::Connection& conn, uint32_t element_id)
+{
+    return read_ext_attributes(conn, element_id).toReply();
+}
+
 int select_ext_attributes(
     tntdb::Connection& conn, uint32_t element_id, std::map<std::string, std::pair<std::string, bool>>& out)
 {
-    auto dbreply = select_ext_attributes(conn, element_id);
-    if (dbreply.status == 0)
+    auto res = read_ext_attributes(conn, element_id);
+    if (!res)
         return -1;
-    out = dbreply.item;
+    out = std::move(res).value();
     return 0;
 }
 
-db_reply<std::vector<db_tmp_link_t>> select_asset_device_links_to(
+fty::db::Result<std::vector<db_tmp_link_t>> read_asset_device_links_to(
     tntdb::Connection& conn, uint32_t element_id, uint8_t link_type_id)
 {
     LOG_START;
     log_debug("element_id = %" PRIi32, element_id);
 
-    std::vector<db_tmp_link_t>           item{};
-    db_reply<std::vector<db_tmp_link_t>> ret = db_reply_new(item);
+    std::vector<db_tmp_link_t> item;
 
     try {
         // Get information about the links the specified device
@@ -1598,6 +1606,7 @@ db_reply<std::vector<db_tmp_link_t>> select_asset_device_links_to(
         log_debug("[v_bios_asset_link]: were selected %" PRIu32 " rows", result.size());
 
         // Go through the selected links
+        item.reserve(result.size());
         for (auto& row : result) {
             db_tmp_link_t m{0, element_id, "", "", ""};
             row[0].get(m.src_id);
@@ -1605,29 +1614,29 @@ db_reply<std::vector<db_tmp_link_t>> select_asset_device_links_to(
             row[2].get(m.dest_socket);
             row[3].get(m.src_name);
 
-            ret.item.push_back(m);
+            item.push_back(std::move(m));
         }
-        ret.status = 1;
         LOG_END;
-        return ret;
+        return item;
     } catch (const std::exception& e) {
-        ret.status     = 0;
-        ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_INTERNAL;
-        ret.msg        = e.what();
-        ret.item.clear();
         LOG_END_ABNORMAL(e);
-        return ret;
+        return fty::db::Result<std::vector<db_tmp_link_t>>::failure(DB_ERR, DB_ERROR_INTERNAL, e.what());
     }
 }
 
-db_reply<std::map<uint32_t, std::string>> select_asset_element_groups(tntdb::Connection& conn, uint32_t element_id)
+db_reply<std::vector<db_tmp_link_t>> select_asset_device_links_to(
+    tntdb::Connection& conn, uint32_t element_id, uint8_t link_type_id)
+{
+    return read_asset_device_links_to(conn, element_id, link_type_id).toReply();
+}
+
+fty::db::Result<std::map<uint32_t, std::string>> read_asset_element_groups(
+    tntdb::Connection& conn, uint32_t element_id)
 {
     LOG_START;
     log_debug("element_id = %" PRIi32, element_id);
 
-    std::map<uint32_t, std::string>           item{};
-    db_reply<std::map<uint32_t, std::string>> ret = db_reply_new(item);
+    std::map<uint32_t, std::string> item;
 
     try {
         // Get information about the groups element belongs to
@@ -1653,30 +1662,253 @@ db_reply<std::map<uint32_t, std::string>> select_asset_element_groups(tntdb::Con
 
             std::string group_name;
             row["name"].get(group_name);
-            ret.item.emplace(group_id, group_name);
+            item.emplace(group_id, std::move(group_name));
         }
-        ret.status = 1;
         LOG_END;
-        return ret;
+        return item;
     } catch (const std::exception& e) {
+        LOG_END_ABNORMAL(e);
+        return fty::db::Result<std::map<uint32_t, std::string>>::failure(DB_ERR, DB_ERROR_INTERNAL, e.what());
+    }
+}
+
+db_reply<std::map<uint32_t, std::string>> select_asset_element_groups(tntdb::Connection& conn, uint32_t element_id)
+{
+    return read_asset_element_groups(conn, element_id).toReply();
+}
+
+// kinds of rows returned by s_asset_full_query
+enum AssetFullRow
+{
+    ASSET_FULL_BASIC = 0,
+    ASSET_FULL_EXT,
+    ASSET_FULL_GROUP,
+    ASSET_FULL_POWER,
+    ASSET_FULL_PARENT
+};
+
+// s_asset_full_query: build one UNION ALL query returning all parts of db_web_element_t
+// every branch returns the same generic columns (kind, n1..n6, s1..s6), meaning of them depends on kind
+// id_expr - SQL expression evaluating to id of the asset
+static std::string s_asset_full_query(const std::string& id_expr)
+{
+    std::string parent_ids, parent_types, parent_subtypes, parent_names;
+    for (int i = 1; i <= 10; i++) {
+        std::string n = std::to_string(i);
+        parent_ids += ", p.id_parent" + n;
+        parent_types += ", p.id_type_parent" + n;
+        parent_subtypes += ", p.id_subtype_parent" + n;
+        parent_names += ", p.name_parent" + n;
+    }
+
+    return
+        // basic data
+        " SELECT"
+        "   " + std::to_string(ASSET_FULL_BASIC) + " AS kind,"
+        "   v.id AS n1, v.id_type AS n2, v.subtype_id AS n3,"
+        "   v.id_parent AS n4, v.id_parent_type AS n5, v.priority AS n6,"
+        "   v.name AS s1, v.type_name AS s2, v.subtype_name AS s3,"
+        "   v.status AS s4, v.asset_tag AS s5, v.parent_name AS s6"
+        " FROM"
+        "   v_web_element v"
+        " WHERE v.id = " + id_expr +
+        // ext attributes
+        " UNION ALL"
+        " SELECT"
+        "   " + std::to_string(ASSET_FULL_EXT) + ","
+        "   e.read_only, NULL, NULL, NULL, NULL, NULL,"
+        "   e.keytag, e.value, NULL, NULL, NULL, NULL"
+        " FROM"
+        "   v_bios_asset_ext_attributes e"
+        " WHERE e.id_asset_element = " + id_expr +
+        // groups
+        " UNION ALL"
+        " SELECT"
+        "   " + std::to_string(ASSET_FULL_GROUP) + ","
+        "   g.id_asset_group, NULL, NULL, NULL, NULL, NULL,"
+        "   a.name, NULL, NULL, NULL, NULL, NULL"
+        " FROM"
+        "   v_bios_asset_group_relation g"
+        " JOIN v_bios_asset_element a ON a.id = g.id_asset_group"
+        " WHERE g.id_asset_element = " + id_expr +
+        // power links the asset is destination of
+        " UNION ALL"
+        " SELECT"
+        "   " + std::to_string(ASSET_FULL_POWER) + ","
+        "   l.id_asset_element_src, NULL, NULL, NULL, NULL, NULL,"
+        "   l.src_out, l.dest_in, l.src_name, NULL, NULL, NULL"
+        " FROM"
+        "   v_web_asset_link l"
+        " WHERE"
+        "   l.id_asset_element_dest = " + id_expr + " AND"
+        "   l.id_asset_link_type = :linktype"
+        // parents, one row per level of v_bios_asset_element_super_parent
+        " UNION ALL"
+        " SELECT"
+        "   " + std::to_string(ASSET_FULL_PARENT) + ","
+        "   CAST(ELT(k.n" + parent_ids + ") AS UNSIGNED),"
+        "   CAST(ELT(k.n" + parent_types + ") AS UNSIGNED),"
+        "   CAST(ELT(k.n" + parent_subtypes + ") AS UNSIGNED),"
+        "   NULL, NULL, k.n,"
+        "   ELT(k.n" + parent_names + "), NULL, NULL, NULL, NULL, NULL"
+        " FROM"
+        "   v_bios_asset_element_super_parent p"
+        " JOIN"
+        "   ( SELECT 1 AS n UNION ALL SELECT 2 UNION ALL SELECT 3 UNION ALL SELECT 4 UNION ALL SELECT 5"
+        "     UNION ALL SELECT 6 UNION ALL SELECT 7 UNION ALL SELECT 8 UNION ALL SELECT 9 UNION ALL SELECT 10 ) k"
+        " WHERE"
+        "   p.id_asset_element = " + id_expr + " AND"
+        "   ELT(k.n" + parent_ids + ") IS NOT NULL"
+        " ORDER BY kind, n6";
+}
+
+static db_reply<db_web_element_t> s_select_asset_full(tntdb::Statement& st)
+{
+    db_web_element_t           item{{0, "", "", 0, 0, "", 0, 0, 0, "", "", ""}, {}, {}, {}, {}};
+    db_reply<db_web_element_t> ret = db_reply_new(item);
+
+    tntdb::Result result = st.set("linktype", INPUT_POWER_CHAIN).select();
+    log_debug("[v_web_element]: were selected %" PRIu32 " rows", result.size());
+
+    bool found = false;
+    for (const auto& row : result) {
+        int kind = -1;
+        row["kind"].get(kind);
+
+        switch (kind) {
+            case ASSET_FULL_BASIC: {
+                found = true;
+                row["n1"].get(ret.item.basic.id);
+                row["n2"].get(ret.item.basic.type_id);
+                row["n3"].get(ret.item.basic.subtype_id);
+                row["n4"].get(ret.item.basic.parent_id);
+                row["n5"].get(ret.item.basic.parent_type_id);
+                row["n6"].get(ret.item.basic.priority);
+                row["s1"].get(ret.item.basic.name);
+                row["s2"].get(ret.item.basic.type_name);
+                row["s3"].get(ret.item.basic.subtype_name);
+                row["s4"].get(ret.item.basic.status);
+                row["s5"].get(ret.item.basic.asset_tag);
+                row["s6"].get(ret.item.basic.parent_name);
+                break;
+            }
+            case ASSET_FULL_EXT: {
+                int         read_only = 0;
+                std::string keytag, value;
+                row["n1"].get(read_only);
+                row["s1"].get(keytag);
+                row["s2"].get(value);
+                ret.item.ext.emplace(keytag, std::make_pair(value, read_only ? true : false));
+                break;
+            }
+            case ASSET_FULL_GROUP: {
+                uint32_t    group_id = 0;
+                std::string group_name;
+                row["n1"].get(group_id);
+                row["s1"].get(group_name);
+                ret.item.groups.emplace(group_id, group_name);
+                break;
+            }
+            case ASSET_FULL_POWER: {
+                db_tmp_link_t m{0, 0, "", "", ""};
+                row["n1"].get(m.src_id);
+                row["s1"].get(m.src_socket);
+                row["s2"].get(m.dest_socket);
+                row["s3"].get(m.src_name);
+                ret.item.powers.push_back(m);
+                break;
+            }
+            case ASSET_FULL_PARENT: {
+                uint32_t    parent_id         = 0;
+                uint16_t    parent_type_id    = 0;
+                uint16_t    parent_subtype_id = 0;
+                std::string parent_name;
+                row["n1"].get(parent_id);
+                row["n2"].get(parent_type_id);
+                row["n3"].get(parent_subtype_id);
+                row["s1"].get(parent_name);
+                ret.item.parents.emplace_back(parent_id, parent_name, persist::typeid_to_type(parent_type_id),
+                    persist::subtypeid_to_subtype(parent_subtype_id));
+                break;
+            }
+            default:
+                log_warning("unexpected row kind %d", kind);
+                break;
+        }
+    }
+
+    if (!found) {
         ret.status     = 0;
         ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_INTERNAL;
-        ret.msg        = e.what();
-        ret.item.clear();
+        ret.errsubtype = DB_ERROR_NOTFOUND;
+        ret.msg        = TRANSLATE_ME("element was not found");
+        ret.item       = db_web_element_t{};
+        return ret;
+    }
+
+    // links were selected before id of the asset was known
+    for (auto& power : ret.item.powers) {
+        power.dest_id = ret.item.basic.id;
+    }
+    ret.status = 1;
+    return ret;
+}
+
+db_reply<db_web_element_t> select_asset_full(tntdb::Connection& conn, uint32_t element_id)
+{
+    LOG_START;
+    log_debug("element_id = %" PRIu32, element_id);
+
+    static const std::string query = s_asset_full_query(":id");
+
+    try {
+        tntdb::Statement st  = conn.prepareCached(query);
+        auto             ret = s_select_asset_full(st.set("id", element_id));
+        LOG_END;
+        return ret;
+    } catch (const std::exception& e) {
+        db_web_element_t           item{};
+        db_reply<db_web_element_t> ret = db_reply_new(item);
+        ret.status                     = 0;
+        ret.errtype                    = DB_ERR;
+        ret.errsubtype                 = DB_ERROR_INTERNAL;
+        ret.msg                        = e.what();
         LOG_END_ABNORMAL(e);
         return ret;
     }
 }
 
-db_reply<std::map<uint32_t, std::string>> select_short_elements(
+db_reply<db_web_element_t> select_asset_full(tntdb::Connection& conn, const std::string& element_name)
+{
+    LOG_START;
+    log_debug("element_name = %s", element_name.c_str());
+
+    static const std::string query =
+        s_asset_full_query("(SELECT id_asset_element FROM t_bios_asset_element WHERE name = :name)");
+
+    try {
+        tntdb::Statement st  = conn.prepareCached(query);
+        auto             ret = s_select_asset_full(st.set("name", element_name));
+        LOG_END;
+        return ret;
+    } catch (const std::exception& e) {
+        db_web_element_t           item{};
+        db_reply<db_web_element_t> ret = db_reply_new(item);
+        ret.status                     = 0;
+        ret.errtype                    = DB_ERR;
+        ret.errsubtype                 = DB_ERROR_INTERNAL;
+        ret.msg                        = e.what();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+}
+
+fty::db::Result<std::map<uint32_t, std::string>> read_short_elements(
     tntdb::Connection& conn, uint16_t type_id, uint16_t subtype_id)
 {
     LOG_START;
     log_debug("  type_id = %" PRIi16, type_id);
     log_debug("  subtype_id = %" PRIi16, subtype_id);
-    std::map<uint32_t, std::string>           item{};
-    db_reply<std::map<uint32_t, std::string>> ret = db_reply_new(item);
 
     std::string query;
     if (subtype_id == 0) {
@@ -1697,9 +1929,11 @@ db_reply<std::map<uint32_t, std::string>> select_short_elements(
             "   v.id_type = :typeid AND "
             "   v.id_subtype = :subtypeid ";
     }
-    try {
+
+    std::function<std::map<uint32_t, std::string>(tntdb::Connection&)> load = [query, type_id, subtype_id](
+                                                                                  tntdb::Connection& c) {
         // Can return more than one row.
-        tntdb::Statement st = conn.prepareCached(query);
+        tntdb::Statement st = c.prepareCached(query);
 
         tntdb::Result result;
         if (subtype_id == 0) {
@@ -1709,33 +1943,38 @@ db_reply<std::map<uint32_t, std::string>> select_short_elements(
         }
 
         // Go through the selected elements
+        std::map<uint32_t, std::string> elements;
         for (auto const& row : result) {
             std::string name;
             row[0].get(name);
             uint32_t id = 0;
             row[1].get(id);
-            ret.item.insert(std::pair<uint32_t, std::string>(id, name));
+            elements.emplace(id, std::move(name));
         }
-        ret.status = 1;
+        return elements;
+    };
+
+    try {
+        auto item = fty::db::QueryCache::get(conn, fty::db::QueryCache::key(query, type_id, subtype_id),
+            {"t_bios_asset_element"}, load, fty::db::QueryCache::dashboardPolicy());
         LOG_END;
-        return ret;
+        return item;
     } catch (const std::exception& e) {
-        ret.status     = 0;
-        ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_INTERNAL;
-        ret.msg        = e.what();
-        ret.item.clear();
         LOG_END_ABNORMAL(e);
-        return ret;
+        return fty::db::Result<std::map<uint32_t, std::string>>::failure(DB_ERR, DB_ERROR_INTERNAL, e.what());
     }
 }
 
-db_reply<std::vector<db_a_elmnt_t>> select_asset_elements_by_type(
-    tntdb::Connection& conn, uint16_t type_id, std::string status)
+db_reply<std::map<uint32_t, std::string>> select_short_elements(
+    tntdb::Connection& conn, uint16_t type_id, uint16_t subtype_id)
 {
+    return read_short_elements(conn, type_id, subtype_id).toReply();
+}
 
-    std::vector<db_a_elmnt_t>           item{};
-    db_reply<std::vector<db_a_elmnt_t>> ret = db_reply_new(item);
+fty::db::Result<std::vector<db_a_elmnt_t>> read_asset_elements_by_type(
+    tntdb::Connection& conn, uint16_t type_id, const std::string& status)
+{
+    std::vector<db_a_elmnt_t> item;
 
     try {
         // Can return more than one row.
@@ -1751,6 +1990,7 @@ db_reply<std::vector<db_a_elmnt_t>> select_asset_elements_by_type(
         log_trace("[v_bios_asset_element]: were selected %" PRIu32 " rows", result.size());
 
         // Go through the selected elements
+        item.reserve(result.size());
         for (auto& row : result) {
             db_a_elmnt_t m{0, "", "", 0, 5, 0, 0, ""};
 
@@ -1763,30 +2003,29 @@ db_reply<std::vector<db_a_elmnt_t>> select_asset_elements_by_type(
             row[4].get(m.id);
             row[5].get(m.subtype_id);
 
-            ret.item.push_back(m);
+            item.push_back(std::move(m));
         }
-        ret.status = 1;
-        return ret;
+        return item;
     } catch (const std::exception& e) {
-        ret.status     = 0;
-        ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_INTERNAL;
-        ret.msg        = e.what();
-        ret.item.clear();
         log_error(e.what());
-        return ret;
+        return fty::db::Result<std::vector<db_a_elmnt_t>>::failure(DB_ERR, DB_ERROR_INTERNAL, e.what());
     }
 }
 
-db_reply<std::set<std::pair<uint32_t, uint32_t>>> select_links_by_container(
-    tntdb::Connection& conn, uint32_t element_id, std::string status)
+db_reply<std::vector<db_a_elmnt_t>> select_asset_elements_by_type(
+    tntdb::Connection& conn, uint16_t type_id, std::string status)
+{
+    return read_asset_elements_by_type(conn, type_id, status).toReply();
+}
+
+fty::db::Result<std::set<std::pair<uint32_t, uint32_t>>> read_links_by_container(
+    tntdb::Connection& conn, uint32_t element_id, const std::string& status)
 {
     log_trace("  links are selected for element_id = %" PRIi32, element_id);
     uint8_t linktype = INPUT_POWER_CHAIN;
 
     //      all powerlinks are included into "resultpowers"
-    std::set<std::pair<uint32_t, uint32_t>>           item{};
-    db_reply<std::set<std::pair<uint32_t, uint32_t>>> ret = db_reply_new(item);
+    std::set<std::pair<uint32_t, uint32_t>> item;
 
     try {
         // v_bios_asset_link are only devices,
@@ -1837,31 +2076,35 @@ db_reply<std::set<std::pair<uint32_t, uint32_t>>> select_links_by_container(
             row[1].get(id_asset_element_dest);
             assert(id_asset_element_dest);
 
-            ret.item.insert(std::pair<uint32_t, uint32_t>(id_asset_element_src, id_asset_element_dest));
+            item.emplace_hint(item.end(), id_asset_element_src, id_asset_element_dest);
         } // end for
-        ret.status = 1;
-        return ret;
+        return item;
     } catch (const std::exception& e) {
-        ret.status     = 0;
-        ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_INTERNAL;
-        ret.msg        = e.what();
         log_error(e.what());
-        return ret;
+        return fty::db::Result<std::set<std::pair<uint32_t, uint32_t>>>::failure(
+            DB_ERR, DB_ERROR_INTERNAL, e.what());
     }
 }
 
+db_reply<std::set<std::pair<uint32_t, uint32_t>>> select_links_by_container(
+    tntdb::Connection& conn, uint32_t element_id, std::string status)
+{
+    return read_links_by_container(conn, element_id, status).toReply();
+}
+
 // returns vector with either active or inactive devices
 std::vector<std::string> list_devices_with_status(tntdb::Connection& conn, std::string status)
 {
-    std::vector<std::string> asset_list;
-    try {
-        tntdb::Statement st = conn.prepareCached(
-            " SELECT"
-            "   v.name, v.id_subtype"
-            " FROM"
-            "   v_bios_asset_element v"
-            " WHERE v.status = :vstatus ");
+    static const std::string query =
+        " SELECT"
+        "   v.name, v.id_subtype"
+        " FROM"
+        "   v_bios_asset_element v"
+        " WHERE v.status = :vstatus ";
+
+    std::function<std::vector<std::string>()> func = [&]() {
+        std::vector<std::string> asset_list;
+        tntdb::Statement         st = conn.prepareCached(query);
 
         tntdb::Result result = st.set("vstatus", status).select();
         log_trace("[v_bios_asset_element]: were selected %" PRIu32 " rows", result.size());
@@ -1870,11 +2113,14 @@ std::vector<std::string> list_devices_with_status(tntdb::Connection& conn, std::
             row[0].get(device);
             asset_list.push_back(device);
         }
-
+        return asset_list;
+    };
+    // the check of the session may fail too
+    try {
+        return fty::db::SingleFlight::run(conn, fty::db::SingleFlight::key(query, status), func);
     } catch (const std::exception&) {
         throw std::runtime_error("Reading from DB failed.");
     }
-    return asset_list;
 }
 
 std::vector<std::string> list_devices_with_status(const std::string& status)
@@ -1888,17 +2134,19 @@ std::vector<std::string> list_devices_with_status(const std::string& status)
 
 std::vector<std::string> list_power_devices_with_status(tntdb::Connection& conn, const std::string& status)
 {
-    std::vector<std::string> asset_list;
-    try {
-        tntdb::Statement st = conn.prepareCached(
-            " SELECT"
-            "   v.name, v.id_subtype"
-            " FROM"
-            "   t_bios_asset_element v"
-            " WHERE v.id_subtype IN "
-            "(SELECT id_asset_device_type FROM t_bios_asset_device_type "
-            "WHERE name IN ('epdu', 'sts', 'ups', 'pdu', 'genset')) "
-            " AND v.status = :vstatus ");
+    static const std::string query =
+        " SELECT"
+        "   v.name, v.id_subtype"
+        " FROM"
+        "   t_bios_asset_element v"
+        " WHERE v.id_subtype IN (" +
+        DBSql::power_device_subtypes() +
+        ")"
+        " AND v.status = :vstatus ";
+
+    std::function<std::vector<std::string>()> func = [&]() {
+        std::vector<std::string> asset_list;
+        tntdb::Statement         st = conn.prepareCached(query);
 
         tntdb::Result result = st.set("vstatus", status).select();
         log_trace("[t_bios_asset_element]: were selected %" PRIu32 " rows", result.size());
@@ -1907,11 +2155,14 @@ std::vector<std::string> list_power_devices_with_status(tntdb::Connection& conn,
             row[0].get(device);
             asset_list.push_back(device);
         }
-
+        return asset_list;
+    };
+    // the check of the session may fail too
+    try {
+        return fty::db::SingleFlight::run(conn, fty::db::SingleFlight::key(query, status), func);
     } catch (const std::exception&) {
         throw std::runtime_error("Reading from DB failed.");
     }
-    return asset_list;
 }
 
 std::vector<std::string> list_power_devices_with_status(const std::string& status)
@@ -1925,18 +2176,24 @@ std::vector<std::string> list_power_devices_with_status(const std::string& statu
 
 int get_active_power_devices(tntdb::Connection& conn)
 {
-    int count = 0;
-    try {
-        tntdb::Statement st = conn.prepareCached(
-            "SELECT COUNT(*) AS CNT FROM t_bios_asset_element "
-            "WHERE id_subtype IN "
-            "(SELECT id_asset_device_type FROM t_bios_asset_device_type "
-            "WHERE name IN ('epdu', 'sts', 'ups', 'pdu', 'genset')) "
-            "AND status = 'active';");
+    static const std::string query =
+        "SELECT COUNT(*) AS CNT FROM t_bios_asset_element "
+        "WHERE id_subtype IN (" +
+        DBSql::power_device_subtypes() +
+        ") "
+        "AND status = 'active';";
+
+    std::function<int(tntdb::Connection&)> load = [](tntdb::Connection& c) {
+        tntdb::Row row = c.prepareCached(query).selectRow();
 
-        tntdb::Row row = st.selectRow();
+        int r = 0;
+        row[0].get(r);
+        return r;
+    };
 
-        row[0].get(count);
+    int count = 0;
+    try {
+        count = fty::db::QueryCache::get(conn, query, {"t_bios_asset_element"}, load);
         log_debug("[get_active_power_devices]: detected %d active power devices", count);
     } catch (const std::exception& e) {
         log_error("exception caught %s when getting count of active power devices", e.what());
@@ -1956,6 +2213,13 @@ std::string get_status_from_db_helper(const std::string& element_name)
 
 std::string get_status_from_db(tntdb::Connection conn, const std::string& element_name)
 {
+    if (auto batch = BatchScope::current()) {
+        std::string status;
+        if (batch->status(conn, element_name, status)) {
+            return status;
+        }
+    }
+
     try {
         log_debug("get_status_from_db: getting status for asset %s", element_name.c_str());
         tntdb::Statement st = conn.prepareCached(
@@ -2019,12 +2283,11 @@ std::set<std::string> get_linked_devices(tntdb::Connection conn, const std::stri
     }
 }
 
-db_reply<std::map<int, std::string>> select_daisy_chain(tntdb::Connection& conn, const std::string& asset_id)
+fty::db::Result<std::map<int, std::string>> read_daisy_chain(tntdb::Connection& conn, const std::string& asset_id)
 {
     LOG_START;
     log_debug("  asset_id = %s", asset_id.c_str());
-    std::map<int, std::string>           item{};
-    db_reply<std::map<int, std::string>> ret = db_reply_new(item);
+    std::map<int, std::string> item;
 
     std::string query = R"EOF(
 select ae_name_out.name, aea_daisychain.value as daisy_chain
@@ -2055,20 +2318,19 @@ select ae_name_out.name, aea_daisychain.value as daisy_chain
             std::string name;
             row[0].get(name);
             row[1].get(daisy_chain);
-            ret.item.emplace(daisy_chain, name);
+            item.emplace(daisy_chain, std::move(name));
         }
-        ret.status = 1;
         LOG_END;
-        return ret;
+        return item;
     } catch (const std::exception& e) {
-        ret.status     = 0;
-        ret.errtype    = DB_ERR;
-        ret.errsubtype = DB_ERROR_INTERNAL;
-        ret.msg        = e.what();
-        ret.item.clear();
         LOG_END_ABNORMAL(e);
-        return ret;
+        return fty::db::Result<std::map<int, std::string>>::failure(DB_ERR, DB_ERROR_INTERNAL, e.what());
     }
 }
 
+db_reply<std::map<int, std::string>> select_daisy_chain(tntdb::Connection& conn, const std::string& asset_id)
+{
+    return read_daisy_chain(conn, asset_id).toReply();
+}
+
 } // namespace DBAssets
@@ -0,0 +1,242 @@
+/*  =========================================================================
+    fty_common_db_asset_batch - Coalescing of per-asset lookups
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_asset_batch - Coalescing of per-asset lookups
+@discuss
+@end
+*/
+
+#include "fty_common_db_asset_batch.h"
+#include "fty_common_db_sql.h"
+#include <fty_common_macros.h>
+#include <algorithm>
+#include <cctype>
+#include <fty_log.h>
+#include <vector>
+
+namespace DBAssets {
+
+static thread_local BatchScope* s_current_scope = nullptr;
+
+// s_foldable: true if s_fold compares name as the collation of MySQL does
+// the collation ignores accents and case of other letters too, such names are not cached
+static bool s_foldable(const std::string& name)
+{
+    return std::all_of(name.begin(), name.end(), [](unsigned char c) {
+        return c < 0x80;
+    });
+}
+
+// s_fold: key of status cache of an ASCII name, MySQL compares names case-insensitively and ignores trailing spaces
+static std::string s_fold(const std::string& name)
+{
+    std::string key(name, 0, name.find_last_not_of(' ') + 1);
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) {
+        return char(std::tolower(c));
+    });
+    return key;
+}
+
+BatchScope::BatchScope()
+    : m_previous(s_current_scope)
+{
+    s_current_scope = this;
+}
+
+BatchScope::~BatchScope()
+{
+    s_current_scope = m_previous;
+}
+
+BatchScope* BatchScope::current()
+{
+    return s_current_scope;
+}
+
+void BatchScope::want_ext_attributes(uint32_t element_id)
+{
+    if (m_ext.count(element_id) == 0) {
+        m_ext_pending.insert(element_id);
+    }
+}
+
+void BatchScope::want_status(const std::string& element_name)
+{
+    if (!s_foldable(element_name)) {
+        return;
+    }
+    std::string key = s_fold(element_name);
+    if (m_status.count(key) == 0) {
+        m_status_pending.insert(key);
+    }
+}
+
+int BatchScope::flush(tntdb::Connection& conn)
+{
+    int rv = flush_ext_attributes(conn);
+    return flush_status(conn) == 0 ? rv : -1;
+}
+
+bool BatchScope::ext_attributes(tntdb::Connection& conn, uint32_t element_id, ext_attributes_t& out)
+{
+    auto it = m_ext.find(element_id);
+    if (it == m_ext.end()) {
+        want_ext_attributes(element_id);
+        if (flush_ext_attributes(conn) != 0) {
+            return false;
+        }
+        it = m_ext.find(element_id);
+    }
+    out = it->second;
+    return true;
+}
+
+bool BatchScope::status(tntdb::Connection& conn, const std::string& element_name, std::string& out)
+{
+    if (!s_foldable(element_name)) {
+        return false;
+    }
+    std::string key = s_fold(element_name);
+    auto        it  = m_status.find(key);
+    if (it == m_status.end()) {
+        want_status(element_name);
+        if (flush_status(conn) != 0) {
+            return false;
+        }
+        it = m_status.find(key);
+        if (it == m_status.end()) {
+            return false;
+        }
+    }
+    out = it->second;
+    return true;
+}
+
+int BatchScope::flush_ext_attributes(tntdb::Connection& conn)
+{
+    if (m_ext_pending.empty()) {
+        return 0;
+    }
+    log_debug("fetching ext attributes of %zu assets", m_ext_pending.size());
+
+    std::vector<uint32_t> ids(m_ext_pending.begin(), m_ext_pending.end());
+    try {
+        for (size_t from = 0; from < ids.size(); from += DBSql::CHUNK_SIZE) {
+            size_t count  = std::min(DBSql::CHUNK_SIZE, ids.size() - from);
+            size_t bucket = DBSql::chunk_bucket(count);
+
+            tntdb::Statement st = conn.prepareCached(
+                " SELECT"
+                "   v.id_asset_element, v.keytag, v.value, v.read_only"
+                " FROM"
+                "   v_bios_asset_ext_attributes v"
+                " WHERE v.id_asset_element IN (" +
+                DBSql::in_list("id", bucket) + ")");
+
+            // pad the list with the last id up to bucket size
+            for (size_t i = 0; i < bucket; i++) {
+                st.set(DBSql::placeholder("id", i), ids[from + std::min(i, count - 1)]);
+            }
+
+            tntdb::Result result = st.select();
+            log_debug("[v_bios_asset_ext_attributes]: were selected %" PRIu32 " rows", result.size());
+
+            // assets without ext attributes are known as well
+            for (size_t i = 0; i < count; i++) {
+                m_ext[ids[from + i]];
+            }
+            for (const auto& row : result) {
+                uint32_t    id = 0;
+                std::string keytag, value;
+                int         read_only = 0;
+                row[0].get(id);
+                row[1].get(keytag);
+                row[2].get(value);
+                row[3].get(read_only);
+                m_ext[id].emplace(keytag, std::make_pair(value, read_only ? true : false));
+            }
+        }
+        m_ext_pending.clear();
+        return 0;
+    } catch (const std::exception& e) {
+        log_error("fetching of ext attributes failed: %s", e.what());
+        return -1;
+    }
+}
+
+int BatchScope::flush_status(tntdb::Connection& conn)
+{
+    if (m_status_pending.empty()) {
+        return 0;
+    }
+    log_debug("fetching status of %zu assets", m_status_pending.size());
+
+    std::vector<std::string> names(m_status_pending.begin(), m_status_pending.end());
+    try {
+        for (size_t from = 0; from < names.size(); from += DBSql::CHUNK_SIZE) {
+            size_t count  = std::min(DBSql::CHUNK_SIZE, names.size() - from);
+            size_t bucket = DBSql::chunk_bucket(count);
+
+            tntdb::Statement st = conn.prepareCached(
+                " SELECT"
+                "   v.name, v.status"
+                " FROM"
+                "   v_bios_asset_element v"
+                " WHERE v.name IN (" +
+                DBSql::in_list("name", bucket) + ")");
+
+            for (size_t i = 0; i < bucket; i++) {
+                st.set(DBSql::placeholder("name", i), names[from + std::min(i, count - 1)]);
+            }
+
+            tntdb::Result result = st.select();
+            log_debug("[v_bios_asset_element]: were selected %" PRIu32 " rows", result.size());
+
+            // an asset with accented name matches some ASCII name, which one is known to MySQL only
+            bool ambiguous = false;
+            for (const auto& row : result) {
+                std::string name, status;
+                row[0].get(name);
+                row[1].get(status);
+                if (s_foldable(name)) {
+                    m_status[s_fold(name)] = status;
+                } else {
+                    ambiguous = true;
+                }
+            }
+            // same answer as get_status_from_db for missing assets, left to it if unsure
+            if (!ambiguous) {
+                for (size_t i = 0; i < count; i++) {
+                    m_status.emplace(names[from + i], "unknown");
+                }
+            }
+        }
+        m_status_pending.clear();
+        return 0;
+    } catch (const std::exception& e) {
+        log_error("fetching of status failed: %s", e.what());
+        return -1;
+    }
+}
+
+} // namespace DBAssets
@@ -0,0 +1,864 @@
+/*  =========================================================================
+    fty_common_db_asset_bulk - Bulk creation of assets
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_asset_bulk - Bulk creation of assets
+@discuss
+@end
+*/
+
+#include "fty_common_db_asset_bulk.h"
+#include "fty_common_db_change.h"
+#include "fty_common_db_notifier.h"
+#include "fty_common_db_sql.h"
+#include "fty_common_db_suffix.h"
+#include <fty_common_asset_types.h>
+#include <fty_common_macros.h>
+#include <fty_log.h>
+#include <set>
+#include <tuple>
+
+namespace DBAssetsInsert {
+
+// s_fail: mark spec as failed, the first reason is kept
+static void s_fail(db_asset_create_t& row, const std::string& msg)
+{
+    if (row.msg.empty()) {
+        row.msg = msg;
+    }
+    row.status = 0;
+}
+
+static bool s_failed(const db_asset_create_t& row)
+{
+    return !row.msg.empty();
+}
+
+// s_select_by_names: id and type id of existing assets with given names
+static std::map<std::string, std::pair<uint32_t, uint16_t>> s_select_by_names(
+    tntdb::Connection& conn, const std::set<std::string>& names)
+{
+    std::map<std::string, std::pair<uint32_t, uint16_t>> found;
+    std::vector<std::string>                             list(names.begin(), names.end());
+
+    for (size_t offset = 0; offset < list.size(); offset += DBSql::CHUNK_SIZE) {
+        size_t count  = std::min(DBSql::CHUNK_SIZE, list.size() - offset);
+        size_t bucket = DBSql::chunk_bucket(count);
+
+        tntdb::Statement st = conn.prepareCached(
+            " SELECT"
+            "   id_asset_element, name, id_type"
+            " FROM"
+            "   t_bios_asset_element"
+            " WHERE"
+            "   name IN (" +
+            DBSql::in_list("name", bucket) + ")");
+        for (size_t i = 0; i < bucket; i++) {
+            st.set(DBSql::placeholder("name", i), list[offset + std::min(i, count - 1)]);
+        }
+
+        for (const auto& row : st.select()) {
+            std::string name;
+            uint32_t    id   = 0;
+            uint16_t    type = 0;
+            row[0].get(id);
+            row[1].get(name);
+            row[2].get(type);
+            found[name] = {id, type};
+        }
+    }
+    return found;
+}
+
+// s_multi_insert: insert rows with chunked multi-row statements
+// set_row(st, i, n) binds values of n-th row to placeholders of i-th row of the statement
+template <typename SetRow>
+static uint64_t s_multi_insert(
+    tntdb::Connection& conn, const std::string& header, size_t tuple_len, size_t rows, SetRow set_row)
+{
+    uint64_t affected = 0;
+    size_t   done     = 0;
+    for (size_t size : DBSql::chunks(rows)) {
+        tntdb::Statement st = conn.prepareCached(DBSql::multi_insert(header, tuple_len, size, ""));
+        for (size_t i = 0; i < size; i++) {
+            set_row(st, i, done + i);
+        }
+        affected += st.execute();
+        done += size;
+    }
+    return affected;
+}
+
+// s_set_or_null: bind value, NULL if it is empty
+static void s_set_or_null(tntdb::Statement& st, const std::string& name, const std::string& value)
+{
+    if (value.empty()) {
+        st.setNull(name);
+    } else {
+        st.set(name, value);
+    }
+}
+
+// s_validate: check specs which can be checked without database, collect names to be resolved
+static void s_validate(const std::vector<db_asset_spec_t>& specs, std::vector<db_asset_create_t>& rows,
+    std::set<std::string>& names)
+{
+    for (size_t i = 0; i < specs.size(); i++) {
+        const auto& spec = specs[i];
+        auto&       row  = rows[i];
+        row.name         = spec.name;
+
+        if (!persist::is_ok_name(spec.name.c_str())) {
+            s_fail(row, "unacceptable name");
+        }
+        if (!persist::is_ok_element_type(spec.type_id)) {
+            s_fail(row, "0 value of element_type_id is not allowed");
+        }
+        // ASSUMPTION: all datacenters are unlocated elements
+        if (spec.type_id == persist::asset_type::DATACENTER && (spec.parent_id != 0 || spec.parent_index >= 0)) {
+            s_fail(row, "datacenter cannot have a parent");
+        }
+        if (spec.parent_id != 0 && spec.parent_index >= 0) {
+            s_fail(row, "parent is specified both by id and by index");
+        }
+        if (spec.parent_index >= int(i)) {
+            s_fail(row, "parent must be specified before its child");
+        }
+        if (spec.status != "active" && spec.status != "nonactive") {
+            s_fail(row, "status must be 'active' or 'nonactive'");
+        }
+        if (spec.priority < 1 || spec.priority > 5) {
+            s_fail(row, "priority must be between 1 and 5");
+        }
+        for (const auto& it : spec.ext) {
+            if (!persist::is_ok_keytag(it.first.c_str()) || !persist::is_ok_value(it.second.first.c_str())) {
+                s_fail(row, "unacceptable ext attribute '" + it.first + "'");
+            }
+        }
+        // power links connect devices only (v_bios_asset_device), as insert_into_asset_link checks
+        if (!spec.links.empty() && spec.type_id != persist::asset_type::DEVICE) {
+            s_fail(row, "power links are allowed for devices only");
+        }
+        for (const auto& link : spec.links) {
+            if (!persist::is_ok_link_type(uint8_t(link.type))) {
+                s_fail(row, "wrong link type");
+            }
+            if (link.src_index >= 0) {
+                if (link.src_index >= int(specs.size()) || link.src_index == int(i)) {
+                    s_fail(row, "wrong index of source device");
+                } else if (specs[size_t(link.src_index)].type_id != persist::asset_type::DEVICE) {
+                    s_fail(row, "source of power link is not a device");
+                }
+            } else if (link.src_name.empty()) {
+                s_fail(row, "source device is not specified");
+            } else {
+                names.insert(link.src_name);
+            }
+        }
+        names.insert(spec.groups.begin(), spec.groups.end());
+        if (!spec.add_suffix) {
+            names.insert(spec.name);
+        }
+    }
+}
+
+// s_resolve: check references to existing assets and names given without suffix
+static void s_resolve(const std::vector<db_asset_spec_t>& specs, std::vector<db_asset_create_t>& rows,
+    const std::map<std::string, std::pair<uint32_t, uint16_t>>& existing)
+{
+    std::set<std::string> batch_names;
+    for (size_t i = 0; i < specs.size(); i++) {
+        const auto& spec = specs[i];
+        auto&       row  = rows[i];
+
+        for (const auto& group : spec.groups) {
+            auto it = existing.find(group);
+            if (it == existing.end() || it->second.second != persist::asset_type::GROUP) {
+                s_fail(row, "group '" + group + "' does not exist");
+            }
+        }
+        for (const auto& link : spec.links) {
+            if (link.src_index >= 0) {
+                continue;
+            }
+            auto it = existing.find(link.src_name);
+            if (it == existing.end()) {
+                s_fail(row, "source device '" + link.src_name + "' does not exist");
+            } else if (it->second.second != persist::asset_type::DEVICE) {
+                s_fail(row, "source of power link '" + link.src_name + "' is not a device");
+            }
+        }
+        if (!spec.add_suffix && (existing.count(spec.name) > 0 || !batch_names.insert(spec.name).second)) {
+            s_fail(row, "asset '" + spec.name + "' already exists");
+        }
+    }
+
+    // specs depending on failed ones fail too
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < specs.size(); i++) {
+            if (s_failed(rows[i])) {
+                continue;
+            }
+            if (specs[i].parent_index >= 0 && s_failed(rows[size_t(specs[i].parent_index)])) {
+                s_fail(rows[i], "parent was not created");
+                changed = true;
+            }
+            for (const auto& link : specs[i].links) {
+                if (link.src_index >= 0 && s_failed(rows[size_t(link.src_index)])) {
+                    s_fail(rows[i], "source device was not created");
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+// s_assign_names: append unique suffixes to names of specs which want them
+static void s_assign_names(
+    tntdb::Connection& conn, const std::vector<db_asset_spec_t>& specs, std::vector<db_asset_create_t>& rows)
+{
+    std::vector<size_t> indexes;
+    for (size_t i = 0; i < specs.size(); i++) {
+        if (!s_failed(rows[i]) && specs[i].add_suffix) {
+            indexes.push_back(i);
+        }
+    }
+
+    auto suffixes = fty::db::SuffixAllocator::take(conn, indexes.size());
+    for (size_t n = 0; n < indexes.size(); n++) {
+        rows[indexes[n]].name = specs[indexes[n]].name + "-" + suffixes[n];
+    }
+}
+
+// s_insert_elements: insert elements level by level (parents first), fill ids of created ones
+static void s_insert_elements(
+    tntdb::Connection& conn, const std::vector<db_asset_spec_t>& specs, std::vector<db_asset_create_t>& rows)
+{
+    std::vector<int> level(specs.size(), 0);
+    int              max_level = 0;
+    for (size_t i = 0; i < specs.size(); i++) {
+        if (!s_failed(rows[i]) && specs[i].parent_index >= 0) {
+            level[i]  = level[size_t(specs[i].parent_index)] + 1;
+            max_level = std::max(max_level, level[i]);
+        }
+    }
+
+    for (int l = 0; l <= max_level; l++) {
+        std::vector<size_t> indexes;
+        for (size_t i = 0; i < specs.size(); i++) {
+            if (!s_failed(rows[i]) && level[i] == l) {
+                indexes.push_back(i);
+            }
+        }
+        if (indexes.empty()) {
+            continue;
+        }
+
+        s_multi_insert(conn,
+            " INSERT INTO t_bios_asset_element "
+            " (name, id_type, id_subtype, id_parent, status, priority, asset_tag) ",
+            7, indexes.size(), [&](tntdb::Statement& st, size_t i, size_t n) {
+                const auto& spec = specs[indexes[n]];
+
+                uint32_t parent_id =
+                    spec.parent_index >= 0 ? rows[size_t(spec.parent_index)].id : spec.parent_id;
+                uint16_t subtype_id = spec.subtype_id == 0 ? uint16_t(persist::asset_subtype::N_A) : spec.subtype_id;
+
+                st.set(DBSql::multi_placeholder(i, 0), rows[indexes[n]].name);
+                st.set(DBSql::multi_placeholder(i, 1), spec.type_id);
+                st.set(DBSql::multi_placeholder(i, 2), subtype_id);
+                if (parent_id == 0) {
+                    st.setNull(DBSql::multi_placeholder(i, 3));
+                } else {
+                    st.set(DBSql::multi_placeholder(i, 3), parent_id);
+                }
+                st.set(DBSql::multi_placeholder(i, 4), spec.status);
+                st.set(DBSql::multi_placeholder(i, 5), spec.priority);
+                s_set_or_null(st, DBSql::multi_placeholder(i, 6), spec.asset_tag);
+            });
+
+        // ids of a multi-row insert are not guaranteed to be consecutive, names are unique
+        std::set<std::string> names;
+        for (size_t i : indexes) {
+            names.insert(rows[i].name);
+        }
+        auto                  created = s_select_by_names(conn, names);
+        std::vector<uint32_t> ids;
+        for (size_t i : indexes) {
+            rows[i].id = created.at(rows[i].name).first;
+            ids.push_back(rows[i].id);
+        }
+        DBChange::record_many(conn, "t_bios_asset_element", DBChange::Op::Insert, ids);
+    }
+}
+
+// s_insert_relations: insert ext attributes, group relations and power links of created elements
+static void s_insert_relations(tntdb::Connection& conn, const std::vector<db_asset_spec_t>& specs,
+    const std::vector<db_asset_create_t>& rows, const std::map<std::string, std::pair<uint32_t, uint16_t>>& existing)
+{
+    struct Ext
+    {
+        uint32_t    id;
+        std::string keytag;
+        std::string value;
+        bool        read_only;
+    };
+    struct Link
+    {
+        uint32_t    src;
+        uint32_t    dest;
+        uint16_t    type;
+        std::string src_out;
+        std::string dest_in;
+    };
+
+    std::vector<Ext>                          exts;
+    std::vector<std::pair<uint32_t, uint32_t>> groups; // (group, element)
+    std::vector<Link>                         links;
+
+    for (size_t i = 0; i < specs.size(); i++) {
+        if (s_failed(rows[i])) {
+            continue;
+        }
+        for (const auto& it : specs[i].ext) {
+            exts.push_back({rows[i].id, it.first, it.second.first, it.second.second});
+        }
+        for (const auto& group : specs[i].groups) {
+            groups.emplace_back(existing.at(group).first, rows[i].id);
+        }
+        // identical links of one spec are inserted once, as insert_into_asset_link would suppress the repeats
+        std::set<std::tuple<uint32_t, std::string, std::string>> seen;
+        for (const auto& link : specs[i].links) {
+            uint32_t src = link.src_index >= 0 ? rows[size_t(link.src_index)].id : existing.at(link.src_name).first;
+            if (seen.emplace(src, link.src_out, link.dest_in).second) {
+                links.push_back({src, rows[i].id, link.type, link.src_out, link.dest_in});
+            }
+        }
+    }
+
+    s_multi_insert(conn, "INSERT INTO t_bios_asset_ext_attributes (keytag, value, id_asset_element, read_only) ", 4,
+        exts.size(), [&exts](tntdb::Statement& st, size_t i, size_t n) {
+            st.set(DBSql::multi_placeholder(i, 0), exts[n].keytag);
+            st.set(DBSql::multi_placeholder(i, 1), exts[n].value);
+            st.set(DBSql::multi_placeholder(i, 2), exts[n].id);
+            st.set(DBSql::multi_placeholder(i, 3), exts[n].read_only);
+        });
+    s_multi_insert(conn, "INSERT INTO t_bios_asset_group_relation (id_asset_group, id_asset_element) ", 2,
+        groups.size(), [&groups](tntdb::Statement& st, size_t i, size_t n) {
+            st.set(DBSql::multi_placeholder(i, 0), groups[n].first);
+            st.set(DBSql::multi_placeholder(i, 1), groups[n].second);
+        });
+    s_multi_insert(conn,
+        "INSERT INTO t_bios_asset_link"
+        " (id_asset_device_src, id_asset_device_dest, id_asset_link_type, src_out, dest_in) ",
+        5, links.size(), [&links](tntdb::Statement& st, size_t i, size_t n) {
+            st.set(DBSql::multi_placeholder(i, 0), links[n].src);
+            st.set(DBSql::multi_placeholder(i, 1), links[n].dest);
+            st.set(DBSql::multi_placeholder(i, 2), links[n].type);
+            s_set_or_null(st, DBSql::multi_placeholder(i, 3), links[n].src_out);
+            s_set_or_null(st, DBSql::multi_placeholder(i, 4), links[n].dest_in);
+        });
+
+    std::vector<uint32_t> ext_ids, group_ids, link_ids;
+    for (const auto& ext : exts) {
+        ext_ids.push_back(ext.id);
+    }
+    for (const auto& group : groups) {
+        group_ids.push_back(group.second);
+    }
+    for (const auto& link : links) {
+        link_ids.push_back(link.dest);
+    }
+    DBChange::record_many(conn, "t_bios_asset_ext_attributes", DBChange::Op::Insert, ext_ids);
+    DBChange::record_many(conn, "t_bios_asset_group_relation", DBChange::Op::Insert, group_ids);
+    DBChange::record_many(conn, "t_bios_asset_link", DBChange::Op::Insert, link_ids);
+}
+
+// s_prepare: validate specs, resolve referenced names and assign names, returns existing assets by name
+static std::map<std::string, std::pair<uint32_t, uint16_t>> s_prepare(
+    tntdb::Connection& conn, const std::vector<db_asset_spec_t>& specs, std::vector<db_asset_create_t>& rows)
+{
+    std::set<std::string> names;
+    s_validate(specs, rows, names);
+
+    auto existing = s_select_by_names(conn, names);
+    s_resolve(specs, rows, existing);
+    s_assign_names(conn, specs, rows);
+    return existing;
+}
+
+// s_fail_all: whole batch failed with exception
+static void s_fail_all(db_reply<std::vector<db_asset_create_t>>& ret, const std::exception& e)
+{
+    for (auto& row : ret.item) {
+        row.id = 0;
+        s_fail(row, e.what());
+    }
+    ret.status     = 0;
+    ret.errtype    = DB_ERR;
+    ret.errsubtype = DB_ERROR_INTERNAL;
+    ret.msg        = e.what();
+}
+
+// s_finish: mark created assets
+static void s_finish(db_reply<std::vector<db_asset_create_t>>& ret)
+{
+    for (auto& row : ret.item) {
+        if (!s_failed(row)) {
+            row.status = 1;
+            ret.affected_rows++;
+        } else {
+            log_error("asset '%s' was not created: %s", row.name.c_str(), row.msg.c_str());
+        }
+    }
+    ret.status = 1;
+}
+
+db_reply<std::vector<db_asset_create_t>> insert_assets(
+    tntdb::Connection& conn, const std::vector<db_asset_spec_t>& specs)
+{
+    LOG_START;
+
+    std::vector<db_asset_create_t>           item(specs.size());
+    db_reply<std::vector<db_asset_create_t>> ret = db_reply_new(item);
+
+    try {
+        auto existing = s_prepare(conn, specs, ret.item);
+
+        // notifications are delivered only if everything is committed
+        fty::db::ChangeNotifier::Deferral deferral;
+        tntdb::Transaction                trans(conn);
+
+        s_insert_elements(conn, specs, ret.item);
+        s_insert_relations(conn, specs, ret.item, existing);
+
+        deferral.prepare();
+        trans.commit();
+        deferral.commit();
+    } catch (const std::exception& e) {
+        s_fail_all(ret, e);
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+
+    s_finish(ret);
+    LOG_END;
+    return ret;
+}
+
+// s_link_rows: derived table of links, one SELECT per link joined by UNION ALL
+static std::string s_link_rows(size_t count)
+{
+    std::string sql;
+    for (size_t i = 0; i < count; i++) {
+        sql += i == 0 ? " SELECT " : " UNION ALL SELECT ";
+        sql += ":" + DBSql::multi_placeholder(i, 0) + " AS idx, ";
+        sql += ":" + DBSql::multi_placeholder(i, 1) + " AS src, ";
+        sql += ":" + DBSql::multi_placeholder(i, 2) + " AS dest, ";
+        sql += ":" + DBSql::multi_placeholder(i, 3) + " AS type, ";
+        sql += ":" + DBSql::multi_placeholder(i, 4) + " AS src_out, ";
+        sql += ":" + DBSql::multi_placeholder(i, 5) + " AS dest_in";
+    }
+    return sql;
+}
+
+// s_set_link: bind n-th link to i-th row of s_link_rows
+static void s_set_link(tntdb::Statement& st, size_t i, size_t n, const link_t& link)
+{
+    st.set(DBSql::multi_placeholder(i, 0), uint64_t(n));
+    st.set(DBSql::multi_placeholder(i, 1), link.src);
+    st.set(DBSql::multi_placeholder(i, 2), link.dest);
+    st.set(DBSql::multi_placeholder(i, 3), link.type);
+    s_set_or_null(st, DBSql::multi_placeholder(i, 4), link.src_out ? link.src_out : "");
+    s_set_or_null(st, DBSql::multi_placeholder(i, 5), link.dest_in ? link.dest_in : "");
+}
+
+// s_set_links: bind links of indexes to the first size rows of s_link_rows
+// missing rows repeat the last link with NULL index, statements skip them
+static void s_set_links(
+    tntdb::Statement& st, size_t size, const std::vector<size_t>& indexes, const std::vector<link_t>& links)
+{
+    for (size_t i = 0; i < size; i++) {
+        size_t n = indexes[std::min(i, indexes.size() - 1)];
+        s_set_link(st, i, n, links[n]);
+        if (i >= indexes.size()) {
+            st.setNull(DBSql::multi_placeholder(i, 0));
+        }
+    }
+}
+
+// s_link_key: links with both sockets set are duplicates if they connect the same sockets
+// (NULL never equals NULL, so links without sockets are never suppressed)
+static std::string s_link_key(const link_t& link)
+{
+    if (!link.src_out || !link.dest_in || !*link.src_out || !*link.dest_in) {
+        return "";
+    }
+    return std::to_string(link.src) + "\x1f" + std::to_string(link.dest) + "\x1f" + link.src_out + "\x1f" +
+           link.dest_in;
+}
+
+// s_inserted_links: which of accepted links were inserted by this transaction
+// must run in the transaction which classified and inserted them: a consistent read sees its own rows by natural
+// key, but not links of the same key committed by someone else after the classification (REPEATABLE READ), links
+// without both sockets are never suppressed, so they are always inserted
+static std::vector<size_t> s_inserted_links(
+    tntdb::Connection& conn, size_t size, const std::vector<size_t>& accepted, const std::vector<link_t>& links)
+{
+    std::set<size_t> found;
+    for (size_t n : accepted) {
+        if (s_link_key(links[n]).empty()) {
+            found.insert(n);
+        }
+    }
+    tntdb::Statement st = conn.prepareCached(
+        " SELECT"
+        "   l.idx"
+        " FROM"
+        "   (" +
+        s_link_rows(size) +
+        ") l"
+        " WHERE"
+        "   l.idx IS NOT NULL AND"
+        "   EXISTS ("
+        "       SELECT"
+        "         id_link"
+        "       FROM"
+        "         t_bios_asset_link v3"
+        "       WHERE"
+        "         v3.id_asset_device_src = l.src AND"
+        "         v3.id_asset_device_dest = l.dest AND"
+        "         v3.src_out = l.src_out AND"
+        "         v3.dest_in = l.dest_in"
+        "   )");
+    s_set_links(st, size, accepted, links);
+    for (const auto& row : st.select()) {
+        uint64_t n = 0;
+        row[0].get(n);
+        found.insert(size_t(n));
+    }
+    return std::vector<size_t>(found.begin(), found.end());
+}
+
+db_reply<std::vector<db_link_insert_t>> insert_asset_links(tntdb::Connection& conn, const std::vector<link_t>& links)
+{
+    LOG_START;
+
+    std::vector<db_link_insert_t>           item(links.size());
+    db_reply<std::vector<db_link_insert_t>> ret = db_reply_new(item);
+
+    // input parameters control, repeated links are suppressed as they would be by sequential inserts
+    std::vector<size_t>   valid;
+    std::set<std::string> keys;
+    for (size_t n = 0; n < links.size(); n++) {
+        auto& out = ret.item[n];
+        if (links[n].dest == 0) {
+            out.msg = "destination device is not specified";
+        } else if (links[n].src == 0) {
+            out.msg = "source device is not specified";
+        } else if (!persist::is_ok_link_type(uint8_t(links[n].type))) {
+            out.msg = "wrong link type";
+        } else {
+            out.status      = 1;
+            std::string key = s_link_key(links[n]);
+            if (!key.empty() && !keys.insert(key).second) {
+                out.msg = "link already exists";
+            } else {
+                valid.push_back(n);
+            }
+        }
+    }
+
+    size_t done = 0;
+    for (size_t size : DBSql::chunks(valid.size())) {
+        try {
+            // the classification is the first read of the chunk transaction, it fixes the snapshot which tells
+            // our links from concurrent ones
+            fty::db::ChangeNotifier::Deferral deferral;
+            tntdb::Transaction                trans(conn);
+
+            // classify links of the chunk
+            tntdb::Statement st = conn.prepareCached(
+                " SELECT"
+                "   l.idx,"
+                "   v1.id_asset_element IS NOT NULL,"
+                "   v2.id_asset_element IS NOT NULL,"
+                "   EXISTS ("
+                "       SELECT"
+                "         id_link"
+                "       FROM"
+                "         t_bios_asset_link v3"
+                "       WHERE"
+                "         v3.id_asset_device_src = l.src AND"
+                "         v3.id_asset_device_dest = l.dest AND"
+                "         v3.src_out = l.src_out AND"
+                "         v3.dest_in = l.dest_in"
+                "   )"
+                " FROM"
+                "   (" +
+                s_link_rows(size) +
+                ") l"
+                " LEFT JOIN v_bios_asset_device v1 ON v1.id_asset_element = l.src"
+                " LEFT JOIN v_bios_asset_device v2 ON v2.id_asset_element = l.dest");
+            s_set_links(st, size, std::vector<size_t>(valid.begin() + long(done), valid.begin() + long(done + size)),
+                links);
+
+            std::vector<size_t> accepted;
+            for (const auto& row : st.select()) {
+                uint64_t n = 0;
+                bool     src = false, dest = false, exists = false;
+                row[0].get(n);
+                row[1].get(src);
+                row[2].get(dest);
+                row[3].get(exists);
+                if (!src) {
+                    ret.item[n].msg = "source device does not exist";
+                } else if (!dest) {
+                    ret.item[n].msg = "destination device does not exist";
+                } else if (exists) {
+                    ret.item[n].msg = "link already exists";
+                } else {
+                    accepted.push_back(size_t(n));
+                }
+            }
+
+            // insert accepted ones by one statement of the shape of the chunk, the guard stays for links inserted
+            // meanwhile by someone else
+            uint64_t inserted = 0;
+            if (!accepted.empty()) {
+                tntdb::Statement ins = conn.prepareCached(
+                    " INSERT INTO"
+                    "   t_bios_asset_link"
+                    "   (id_asset_device_src, id_asset_device_dest,"
+                    "        id_asset_link_type, src_out, dest_in)"
+                    " SELECT"
+                    "   l.src, l.dest, l.type, l.src_out, l.dest_in"
+                    " FROM"
+                    "   (" +
+                    s_link_rows(size) +
+                    ") l"
+                    " WHERE"
+                    "   l.idx IS NOT NULL AND"
+                    "   NOT EXISTS ("
+                    "       SELECT"
+                    "         id_link"
+                    "       FROM"
+                    "         t_bios_asset_link v3"
+                    "       WHERE"
+                    "         v3.id_asset_device_src = l.src AND"
+                    "         v3.id_asset_device_dest = l.dest AND"
+                    "         v3.src_out = l.src_out AND"
+                    "         v3.dest_in = l.dest_in"
+                    "   )");
+                s_set_links(ins, size, accepted, links);
+                inserted = ins.execute();
+            }
+
+            std::vector<size_t> created = accepted;
+            if (inserted != accepted.size()) {
+                log_error("%zu links were inserted concurrently", accepted.size() - size_t(inserted));
+                created = s_inserted_links(conn, size, accepted, links);
+                for (size_t n : accepted) {
+                    ret.item[n].msg = "link already exists";
+                }
+            }
+
+            std::vector<uint32_t> dests;
+            for (size_t n : created) {
+                ret.item[n].affected_rows = 1;
+                ret.item[n].msg.clear();
+                dests.push_back(links[n].dest);
+            }
+            DBChange::record_many(conn, "t_bios_asset_link", DBChange::Op::Insert, dests);
+
+            deferral.prepare();
+            trans.commit();
+            deferral.commit();
+            ret.affected_rows += inserted;
+        } catch (const std::exception& e) {
+            for (size_t i = 0; i < size; i++) {
+                ret.item[valid[done + i]].status        = 0;
+                ret.item[valid[done + i]].affected_rows = 0;
+                ret.item[valid[done + i]].msg           = e.what();
+            }
+            ret.status     = 0;
+            ret.errtype    = DB_ERR;
+            ret.errsubtype = DB_ERROR_INTERNAL;
+            ret.msg        = e.what();
+            log_error("%s", e.what());
+        }
+        done += size;
+    }
+
+    log_debug("[t_bios_asset_link]: was inserted %" PRIu64 " rows", ret.affected_rows);
+    LOG_END;
+    return ret;
+}
+
+db_reply<std::vector<db_link_insert_t>> insert_new_asset_links(
+    tntdb::Connection& conn, const std::vector<new_link_t>& links)
+{
+    LOG_START;
+
+    std::set<std::string> names;
+    for (const auto& link : links) {
+        if (!link.src.empty()) {
+            names.insert(link.src);
+        }
+        if (!link.dest.empty()) {
+            names.insert(link.dest);
+        }
+    }
+
+    std::map<std::string, std::pair<uint32_t, uint16_t>> existing;
+    try {
+        existing = s_select_by_names(conn, names);
+    } catch (const std::exception& e) {
+        std::vector<db_link_insert_t>           item(links.size());
+        db_reply<std::vector<db_link_insert_t>> ret = db_reply_new(item);
+        for (auto& out : ret.item) {
+            out.msg = e.what();
+        }
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_INTERNAL;
+        ret.msg        = e.what();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+
+    // unknown names get an id no device has, such links are suppressed
+    auto s_id = [&existing](const std::string& name) -> uint32_t {
+        if (name.empty()) {
+            return 0;
+        }
+        auto it = existing.find(name);
+        return it == existing.end() ? UINT32_MAX : it->second.first;
+    };
+
+    std::vector<link_t> resolved;
+    for (const auto& link : links) {
+        resolved.push_back({s_id(link.src), s_id(link.dest), link.src_out, link.dest_in, link.type});
+    }
+
+    auto ret = insert_asset_links(conn, resolved);
+    LOG_END;
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+AssetWriter::AssetWriter(tntdb::Connection& conn)
+    : m_conn(conn)
+{
+}
+
+size_t AssetWriter::add(const db_asset_spec_t& spec)
+{
+    m_specs.push_back(spec);
+    return m_specs.size() - 1;
+}
+
+db_asset_spec_t& AssetWriter::spec(size_t index)
+{
+    return m_specs.at(index);
+}
+
+void AssetWriter::monitor(size_t index, uint16_t monitor_id)
+{
+    m_monitors.emplace_back(index, monitor_id);
+}
+
+db_reply<std::vector<db_asset_create_t>> AssetWriter::commit()
+{
+    LOG_START;
+
+    std::vector<db_asset_spec_t>             specs;
+    std::vector<std::pair<size_t, uint16_t>> monitors;
+    specs.swap(m_specs);
+    monitors.swap(m_monitors);
+
+    std::vector<db_asset_create_t>           item(specs.size());
+    db_reply<std::vector<db_asset_create_t>> ret = db_reply_new(item);
+
+    for (const auto& it : monitors) {
+        if (it.first >= specs.size() || it.second == 0) {
+            ret.status     = 0;
+            ret.errtype    = DB_ERR;
+            ret.errsubtype = DB_ERROR_BADINPUT;
+            ret.msg        = "wrong monitor relation";
+            log_error("end: %s, %s", "ignore insert", ret.msg.c_str());
+            return ret;
+        }
+    }
+
+    try {
+        auto existing = s_prepare(m_conn, specs, ret.item);
+
+        // all or nothing, the first reason is reported for the whole unit
+        for (size_t i = 0; i < specs.size(); i++) {
+            if (s_failed(ret.item[i])) {
+                ret.status     = 0;
+                ret.errtype    = DB_ERR;
+                ret.errsubtype = DB_ERROR_BADINPUT;
+                ret.msg        = "asset '" + specs[i].name + "': " + ret.item[i].msg;
+                for (auto& row : ret.item) {
+                    s_fail(row, "not created, " + ret.msg);
+                }
+                log_error("end: %s, %s", "ignore insert", ret.msg.c_str());
+                return ret;
+            }
+        }
+
+        fty::db::ChangeNotifier::Deferral deferral;
+        tntdb::Transaction                trans(m_conn);
+
+        s_insert_elements(m_conn, specs, ret.item);
+        s_insert_relations(m_conn, specs, ret.item, existing);
+        s_multi_insert(m_conn, " INSERT INTO t_bios_monitor_asset_relation (id_discovered_device, id_asset_element) ",
+            2, monitors.size(), [&](tntdb::Statement& st, size_t i, size_t n) {
+                st.set(DBSql::multi_placeholder(i, 0), monitors[n].second);
+                st.set(DBSql::multi_placeholder(i, 1), ret.item[monitors[n].first].id);
+            });
+        std::vector<uint32_t> monitored;
+        for (const auto& it : monitors) {
+            monitored.push_back(ret.item[it.first].id);
+        }
+        DBChange::record_many(m_conn, "t_bios_monitor_asset_relation", DBChange::Op::Insert, monitored);
+
+        deferral.prepare();
+        trans.commit();
+        deferral.commit();
+    } catch (const std::exception& e) {
+        s_fail_all(ret, e);
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+
+    s_finish(ret);
+    LOG_END;
+    return ret;
+}
+
+} // namespace DBAssetsInsert
@@ -0,0 +1,172 @@
+/*  =========================================================================
+    fty_common_db_asset_configured - Materialised configured state of assets
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_asset_configured - Materialised configured state of assets
+@discuss
+@end
+*/
+
+#include "fty_common_db_asset_configured.h"
+#include "fty_common_db_configured.h"
+#include "fty_common_db_session.h"
+#include "fty_common_db_sql.h"
+#include <algorithm>
+#include <atomic>
+#include <fty_log.h>
+#include <iterator>
+
+namespace DBConfigured {
+
+static std::atomic<bool> s_enabled{false};
+
+// s_state: 1 for configured, 0 for not configured, NULL for assets to which the option does not apply
+static std::string s_state()
+{
+    return " CASE WHEN " + condition(true) + " THEN 1 WHEN " + condition(false) + " THEN 0 ELSE NULL END ";
+}
+
+bool enabled()
+{
+    return s_enabled;
+}
+
+// s_refresh_chunk: recompute the state of up to CHUNK_SIZE assets from offset and of their direct children
+// the IN lists are padded to a power of two by repeating the last id, so only a few shapes are prepared
+static void s_refresh_chunk(tntdb::Connection& conn, const std::vector<uint32_t>& ids, size_t offset)
+{
+    size_t      count  = std::min(DBSql::CHUNK_SIZE, ids.size() - offset);
+    size_t      bucket = DBSql::chunk_bucket(count);
+    std::string list   = DBSql::in_list("id", bucket);
+
+    tntdb::Statement del = conn.prepareCached(
+        " DELETE FROM t_bios_asset_configured"
+        " WHERE"
+        "   id_asset_element IN (" + list + ") OR"
+        "   id_asset_element IN ("
+        "     SELECT id_asset_element FROM t_bios_asset_element WHERE id_parent IN (" + list + "))");
+    tntdb::Statement ins = conn.prepareCached(
+        " INSERT INTO t_bios_asset_configured"
+        "   (id_asset_element, configured)"
+        " SELECT"
+        "   v.id_asset_element, " +
+        s_state() +
+        " FROM"
+        "   v_bios_asset_element_super_parent AS v"
+        " WHERE"
+        "   v.id_asset_element IN (" + list + ") OR v.id_parent1 IN (" + list + ")");
+    for (size_t i = 0; i < bucket; i++) {
+        uint32_t id = ids[offset + std::min(i, count - 1)];
+        del.set(DBSql::placeholder("id", i), id);
+        ins.set(DBSql::placeholder("id", i), id);
+    }
+    del.execute();
+    ins.execute();
+}
+
+void refresh(tntdb::Connection& conn, uint32_t asset_id)
+{
+    refresh_many(conn, {asset_id});
+}
+
+void refresh_many(tntdb::Connection& conn, const std::vector<uint32_t>& asset_ids)
+{
+    std::vector<uint32_t> ids;
+    std::copy_if(asset_ids.begin(), asset_ids.end(), std::back_inserter(ids), [](uint32_t id) {
+        return id != 0;
+    });
+    if (!s_enabled || ids.empty()) {
+        return;
+    }
+
+    for (size_t offset = 0; offset < ids.size(); offset += DBSql::CHUNK_SIZE) {
+        // one retry after lock wait timeout, which rolls back only the statement
+        for (int attempt = 0;; attempt++) {
+            try {
+                s_refresh_chunk(conn, ids, offset);
+                break;
+            } catch (const std::exception& e) {
+                if (DBSession::deadlock(e)) {
+                    throw;
+                }
+                if (attempt == 0 && DBSession::lock_wait_timeout(e)) {
+                    log_warning("configured state of %zu assets not refreshed, retrying: %s", ids.size(), e.what());
+                    continue;
+                }
+                // the triggers dropped the state of these assets, filters compute it at query time
+                log_error("configured state of %zu assets was not refreshed: %s", ids.size(), e.what());
+                return;
+            }
+        }
+    }
+}
+
+} // namespace DBConfigured
+
+namespace DBAssets {
+
+int enable_configured_table(tntdb::Connection& conn)
+{
+    LOG_START;
+    // the table and its triggers are created by the schema migration, a missing table fails the rebuild
+    // enable first, so writes done while rebuilding are applied too
+    DBConfigured::s_enabled = true;
+    if (rebuild_configured_table(conn) != 0) {
+        DBConfigured::s_enabled = false;
+        return -1;
+    }
+    LOG_END;
+    return 0;
+}
+
+void disable_configured_table()
+{
+    DBConfigured::s_enabled = false;
+}
+
+int rebuild_configured_table(tntdb::Connection& conn)
+{
+    LOG_START;
+    try {
+        tntdb::Transaction trans(conn);
+        conn.execute("DELETE FROM t_bios_asset_configured");
+        conn.execute(
+            " INSERT INTO t_bios_asset_configured"
+            "   (id_asset_element, configured)"
+            " SELECT"
+            "   v.id_asset_element, " +
+            DBConfigured::s_state() +
+            " FROM"
+            "   v_bios_asset_element_super_parent AS v");
+        trans.commit();
+        LOG_END;
+        return 0;
+    } catch (const std::exception& e) {
+        if (DBSession::missing_table(e)) {
+            log_error("t_bios_asset_configured is missing (schema migration 0003_asset_configured.sql not applied)");
+        }
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
+} // namespace DBAssets
@@ -27,8 +27,14 @@
 */
 
 #include "fty_common_db.h"
+#include "fty_common_db_change.h"
+#include "fty_common_db_sql.h"
 #include <fty_common_asset_types.h>
+#include <algorithm>
 #include <fty_log.h>
+#include <map>
+#include <set>
+#include <tntdb/transaction.h>
 
 namespace DBAssetsDelete {
 
@@ -72,6 +78,7 @@ db_reply_t delete_asset_link(tntdb::Connection& conn, uint32_t asset_element_id_
             "   id_asset_device_dest = :dest");
 
         ret.affected_rows = st.set("src", asset_element_id_src).set("dest", asset_element_id_dest).execute();
+        DBChange::record(conn, "t_bios_asset_link", DBChange::Op::Delete, asset_element_id_dest, ret.affected_rows);
         log_debug("[t_bios_asset_link]: was deleted %" PRIu64 " rows", ret.affected_rows);
         ret.status = 1;
         LOG_END;
@@ -101,6 +108,7 @@ db_reply_t delete_asset_links_to(tntdb::Connection& conn, uint32_t asset_device_
             "   id_asset_device_dest = :dest");
 
         ret.affected_rows = st.set("dest", asset_device_id).execute();
+        DBChange::record(conn, "t_bios_asset_link", DBChange::Op::Delete, asset_device_id, ret.affected_rows);
         log_debug("[t_bios_asset_link]: was deleted %" PRIu64 " rows", ret.affected_rows);
         ret.status = 1;
         LOG_END;
@@ -132,6 +140,7 @@ db_reply_t delete_asset_group_links(tntdb::Connection& conn, uint32_t asset_grou
             "   id_asset_group = :grp");
 
         ret.affected_rows = st.set("grp", asset_group_id).execute();
+        DBChange::record(conn, "t_bios_asset_group_relation", DBChange::Op::Delete, asset_group_id, ret.affected_rows);
         log_debug("[t_bios_asset_group_relation]: was deleted %" PRIu64 " rows", ret.affected_rows);
         ret.status = 1;
         LOG_END;
@@ -183,6 +192,8 @@ db_reply_t delete_asset_ext_attribute(tntdb::Connection& conn, const char* keyta
             "   id_asset_element = :element");
 
         ret.affected_rows = st.set("keytag", keytag).set("element", asset_element_id).execute();
+        DBChange::record(
+            conn, "t_bios_asset_ext_attributes", DBChange::Op::Delete, asset_element_id, ret.affected_rows);
         log_debug("[t_bios_asset_ext_attributes]: was deleted %" PRIu64 " rows", ret.affected_rows);
         if ((ret.affected_rows == 1) || (ret.affected_rows == 0)) {
             ret.status = 1;
@@ -222,6 +233,8 @@ db_reply_t delete_asset_ext_attributes_with_ro(tntdb::Connection& conn, uint32_t
             "   read_only = :ro ");
 
         ret.affected_rows = st.set("element", asset_element_id).set("ro", read_only).execute();
+        DBChange::record(
+            conn, "t_bios_asset_ext_attributes", DBChange::Op::Delete, asset_element_id, ret.affected_rows);
         log_debug("[t_bios_asset_ext_attributes]: was deleted %" PRIu64 " rows", ret.affected_rows);
         ret.status = 1;
         LOG_END;
@@ -244,6 +257,25 @@ db_reply_t delete_asset_element(tntdb::Connection& conn, uint32_t asset_element_
     db_reply_t ret = db_reply_new();
 
     try {
+        // power links from the asset are deleted by cascade, their destinations change as well
+        tntdb::Statement st_dests = conn.prepareCached(
+            " SELECT"
+            "   id_asset_device_dest, COUNT(*)"
+            " FROM"
+            "   t_bios_asset_link"
+            " WHERE"
+            "   id_asset_device_src = :element"
+            " GROUP BY id_asset_device_dest");
+
+        std::map<uint32_t, uint64_t> dests;
+        for (const auto& row : st_dests.set("element", asset_element_id).select()) {
+            uint32_t dest  = 0;
+            uint64_t count = 0;
+            row[0].get(dest);
+            row[1].get(count);
+            dests[dest] = count;
+        }
+
         tntdb::Statement st = conn.prepareCached(
             " DELETE FROM"
             "   t_bios_asset_element"
@@ -251,6 +283,11 @@ db_reply_t delete_asset_element(tntdb::Connection& conn, uint32_t asset_element_
             "   id_asset_element = :element");
 
         ret.affected_rows = st.set("element", asset_element_id).execute();
+        DBChange::record(conn, "t_bios_asset_element", DBChange::Op::Delete, asset_element_id, ret.affected_rows);
+        for (const auto& it : dests) {
+            DBChange::record(conn, "t_bios_asset_link", DBChange::Op::Delete, it.first,
+                ret.affected_rows == 1 ? it.second : 0);
+        }
         log_debug("[t_bios_asset_element]: was deleted %" PRIu64 " rows", ret.affected_rows);
         if ((ret.affected_rows == 1) || (ret.affected_rows == 0)) {
             ret.status = 1;
@@ -289,6 +326,8 @@ db_reply_t delete_asset_element_from_asset_groups(tntdb::Connection& conn, uint3
             "   id_asset_element = :element");
 
         ret.affected_rows = st.set("element", asset_element_id).execute();
+        DBChange::record(
+            conn, "t_bios_asset_group_relation", DBChange::Op::Delete, asset_element_id, ret.affected_rows);
         log_debug("[t_bios_asset_group_relation]: was deleted %" PRIu64 " rows", ret.affected_rows);
         ret.status = 1;
         LOG_END;
@@ -321,6 +360,8 @@ db_reply_t delete_asset_element_from_asset_group(
             "   id_asset_element = :element");
 
         ret.affected_rows = st.set("grp", asset_group_id).set("element", asset_element_id).execute();
+        DBChange::record(
+            conn, "t_bios_asset_group_relation", DBChange::Op::Delete, asset_element_id, ret.affected_rows);
         log_debug("[t_bios_asset_group_relation]: was deleted %" PRIu64 " rows", ret.affected_rows);
         if ((ret.affected_rows == 1) || (ret.affected_rows == 0)) {
             ret.status = 1;
@@ -360,6 +401,7 @@ db_reply_t delete_monitor_asset_relation_by_a(tntdb::Connection& conn, uint32_t
             "   id_asset_element = :id");
 
         ret.affected_rows = st.set("id", id).execute();
+        DBChange::record(conn, "t_bios_monitor_asset_relation", DBChange::Op::Delete, id, ret.affected_rows);
         log_debug("[t_bios_monitor_asset_relation]: was deleted %" PRIu64 " rows", ret.affected_rows);
         ret.status = 1;
         LOG_END;
@@ -373,4 +415,164 @@ db_reply_t delete_monitor_asset_relation_by_a(tntdb::Connection& conn, uint32_t
         return ret;
     }
 }
+
+/////////////////////////////////////////////////////////////////////////////
+
+// s_bind_ids: bind chunk of ids to placeholders of DBSql::in_list("id", bucket)
+static void s_bind_ids(
+    tntdb::Statement& st, const std::vector<uint32_t>& ids, size_t offset, size_t count, size_t bucket)
+{
+    for (size_t i = 0; i < bucket; i++) {
+        st.set(DBSql::placeholder("id", i), ids[offset + std::min(i, count - 1)]);
+    }
+}
+
+// s_select_in: ids selected by query with "%IDS%" placeholders, one query per 256 ids
+static std::set<uint32_t> s_select_in(tntdb::Connection& conn, const std::string& sql, const std::vector<uint32_t>& ids)
+{
+    std::set<uint32_t> found;
+    for (size_t offset = 0; offset < ids.size(); offset += DBSql::CHUNK_SIZE) {
+        size_t count  = std::min(DBSql::CHUNK_SIZE, ids.size() - offset);
+        size_t bucket = DBSql::chunk_bucket(count);
+
+        tntdb::Statement st = conn.prepareCached(DBSql::in_sql(sql, bucket));
+        s_bind_ids(st, ids, offset, count, bucket);
+        for (const auto& row : st.select()) {
+            uint32_t id = 0;
+            row[0].get(id);
+            found.insert(id);
+        }
+    }
+    return found;
+}
+
+// s_execute_in: execute statement with "%IDS%" placeholders, one statement per 256 ids
+static uint64_t s_execute_in(tntdb::Connection& conn, const std::string& sql, const std::vector<uint32_t>& ids)
+{
+    uint64_t affected = 0;
+    for (size_t offset = 0; offset < ids.size(); offset += DBSql::CHUNK_SIZE) {
+        size_t count  = std::min(DBSql::CHUNK_SIZE, ids.size() - offset);
+        size_t bucket = DBSql::chunk_bucket(count);
+
+        tntdb::Statement st = conn.prepareCached(DBSql::in_sql(sql, bucket));
+        s_bind_ids(st, ids, offset, count, bucket);
+        affected += st.execute();
+    }
+    return affected;
+}
+
+db_reply<std::vector<uint32_t>> delete_assets(
+    tntdb::Connection& conn, const std::vector<uint32_t>& ids, const db_delete_options_t& options)
+{
+    LOG_START;
+    log_debug("  count = %zu, subtree = %i, detach_children = %i", ids.size(), options.subtree,
+        options.detach_children);
+
+    std::vector<uint32_t>           item{};
+    db_reply<std::vector<uint32_t>> ret = db_reply_new(item);
+
+    std::vector<uint32_t> given(ids.begin(), ids.end());
+    given.erase(std::remove(given.begin(), given.end(), 0), given.end());
+    if (given.empty()) {
+        log_debug("nothing to delete");
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    }
+
+    static const std::string children_QUERY =
+        " SELECT id_asset_element FROM t_bios_asset_element WHERE id_parent IN (%IDS%)";
+
+    try {
+        fty::db::ChangeNotifier::Deferral deferral;
+        tntdb::Transaction                trans(conn);
+
+        // existing ones, locked until commit
+        std::set<uint32_t> assets = s_select_in(conn,
+            " SELECT id_asset_element FROM t_bios_asset_element WHERE id_asset_element IN (%IDS%) FOR UPDATE", given);
+
+        // whole subtrees, level by level
+        if (options.subtree) {
+            std::vector<uint32_t> level(assets.begin(), assets.end());
+            while (!level.empty()) {
+                std::vector<uint32_t> next;
+                for (uint32_t child : s_select_in(conn, children_QUERY, level)) {
+                    if (assets.insert(child).second) {
+                        next.push_back(child);
+                    }
+                }
+                level.swap(next);
+            }
+        }
+        std::vector<uint32_t> list(assets.begin(), assets.end());
+
+        // children which stay
+        std::vector<uint32_t> detached;
+        for (uint32_t child : s_select_in(conn, children_QUERY, list)) {
+            if (assets.count(child) == 0) {
+                detached.push_back(child);
+            }
+        }
+        if (!detached.empty() && !options.detach_children) {
+            ret.status     = 0;
+            ret.errtype    = DB_ERR;
+            ret.errsubtype = DB_ERROR_BADINPUT;
+            ret.msg        = "asset " + std::to_string(detached.front()) + " is located in deleted asset";
+            log_error("end: %s, %s", "ignore delete", ret.msg.c_str());
+            return ret;
+        }
+
+        // dependent rows first, deleted assets are detached from each other so their order does not matter
+        // destinations of deleted links, locked so the delete below removes exactly these links
+        std::set<uint32_t> link_dests = s_select_in(conn,
+            " SELECT id_asset_device_dest FROM t_bios_asset_link"
+            " WHERE id_asset_device_src IN (%IDS%) OR id_asset_device_dest IN (%IDS%) FOR UPDATE",
+            list);
+        uint64_t links = s_execute_in(conn,
+            " DELETE FROM t_bios_asset_link"
+            " WHERE id_asset_device_src IN (%IDS%) OR id_asset_device_dest IN (%IDS%)",
+            list);
+        uint64_t groups = s_execute_in(conn,
+            " DELETE FROM t_bios_asset_group_relation"
+            " WHERE id_asset_element IN (%IDS%) OR id_asset_group IN (%IDS%)",
+            list);
+        uint64_t ext =
+            s_execute_in(conn, " DELETE FROM t_bios_asset_ext_attributes WHERE id_asset_element IN (%IDS%)", list);
+        uint64_t monitors =
+            s_execute_in(conn, " DELETE FROM t_bios_monitor_asset_relation WHERE id_asset_element IN (%IDS%)", list);
+        s_execute_in(conn, " UPDATE t_bios_asset_element SET id_parent = NULL WHERE id_parent IN (%IDS%)", list);
+        ret.affected_rows =
+            s_execute_in(conn, " DELETE FROM t_bios_asset_element WHERE id_asset_element IN (%IDS%)", list);
+
+        // dependent tables are journaled by the delete of the asset, only cache and observers are told here
+        DBChange::record(conn, "t_bios_asset_ext_attributes", DBChange::Op::Delete, 0, ext);
+        DBChange::record(conn, "t_bios_asset_group_relation", DBChange::Op::Delete, 0, groups);
+        DBChange::record(conn, "t_bios_monitor_asset_relation", DBChange::Op::Delete, 0, monitors);
+        if (links > 0) {
+            DBChange::record_many(conn, "t_bios_asset_link", DBChange::Op::Delete,
+                std::vector<uint32_t>(link_dests.begin(), link_dests.end()));
+        }
+        DBChange::record_many(conn, "t_bios_asset_element", DBChange::Op::Update, detached);
+        DBChange::record_many(conn, "t_bios_asset_element", DBChange::Op::Delete, list);
+
+        deferral.prepare();
+        trans.commit();
+        deferral.commit();
+
+        ret.item = list;
+        log_debug("[t_bios_asset_element]: was deleted %" PRIu64 " rows", ret.affected_rows);
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    } catch (const std::exception& e) {
+        ret.item.clear();
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_DELETEFAIL;
+        ret.msg        = e.what();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+}
+
 } // namespace DBAssetsDelete
@@ -0,0 +1,448 @@
+/*  =========================================================================
+    fty_common_db_asset_filter - Filter of the asset listing functions
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_asset_filter - Filter of the asset listing functions
+@discuss
+@end
+*/
+
+#include "fty_common_db_asset_filter.h"
+#include "fty_common_db_configured.h"
+#include "fty_common_db_sql.h"
+#include <fty_common_asset_types.h>
+#include <fty_log.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace DBAssets {
+
+enum class Without
+{
+    None,
+    Location,
+    Powerchain,
+    Attribute
+};
+
+enum class Configured
+{
+    Any,
+    Yes,
+    No
+};
+
+// Columns: names which differ between the sources of the scopes
+struct Columns
+{
+    std::string alias;   // alias of the source
+    std::string subtype; // subtype id column
+    std::string parent;  // direct parent column
+};
+
+// s_view: true if the source is v_bios_asset_element_super_parent
+static bool s_view(AssetFilter::Scope scope)
+{
+    return scope != AssetFilter::Scope::All;
+}
+
+static Columns s_columns(AssetFilter::Scope scope)
+{
+    if (s_view(scope)) {
+        return {"v", "v.id_asset_device_type", "v.id_parent1"};
+    }
+    return {"t", "t.id_subtype", "t.id_parent"};
+}
+
+// s_bucket: number of placeholders for a list of count values, 0 for an empty list
+static size_t s_bucket(size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    return count > DBSql::CHUNK_SIZE ? count : DBSql::chunk_bucket(count);
+}
+
+static std::string s_power_chain(const Columns& c)
+{
+    return " (SELECT id_asset_device_dest"
+           "  FROM t_bios_asset_link_type AS l JOIN t_bios_asset_link AS a"
+           "  ON a.id_asset_link_type = l.id_asset_link_type"
+           "  WHERE name = \"power chain\" AND " +
+           c.alias + ".id_asset_element = a.id_asset_device_dest) ";
+}
+
+// s_sensor_located: condition for sensors having both parents
+// for the container scopes the parents are in the view, otherwise the view must be looked up
+static std::string s_sensor_located(AssetFilter::Scope scope, const Columns& c, bool located)
+{
+    if (s_view(scope)) {
+        return located ? " (v.id_parent1 IS NOT NULL AND v.id_parent2 IS NOT NULL) "
+                       : " (v.id_parent1 IS NULL OR v.id_parent2 IS NULL) ";
+    }
+    return std::string(located ? " EXISTS " : " NOT EXISTS ") +
+           " (SELECT * FROM v_bios_asset_element_super_parent AS v"
+           "  WHERE " +
+           c.alias +
+           ".id_asset_element = v.id_asset_element"
+           "  AND v.id_parent1 IS NOT NULL AND v.id_parent2 IS NOT NULL) ";
+}
+
+static std::string s_configured(AssetFilter::Scope scope, const Columns& c, bool yes)
+{
+    std::ostringstream powerchain_subtypes;
+    powerchain_subtypes << persist::asset_subtype::UPS << "," << persist::asset_subtype::PDU << ","
+                        << persist::asset_subtype::EPDU << "," << persist::asset_subtype::STS << ","
+                        << persist::asset_subtype::SERVER << "," << persist::asset_subtype::STORAGE << ","
+                        << persist::asset_subtype::PATCHPANEL << "," << persist::asset_subtype::SWITCH << ","
+                        << persist::asset_subtype::ROUTER << "," << persist::asset_subtype::APPLIANCE << ","
+                        << persist::asset_subtype::CHASSIS << "," << persist::asset_subtype::OTHER << ","
+                        << persist::asset_subtype::PCU;
+    std::ostringstream located_types;
+    located_types << persist::asset_type::ROOM << "," << persist::asset_type::ROW << "," << persist::asset_type::RACK
+                  << "," << persist::asset_type::DEVICE;
+    std::ostringstream other_subtypes;
+    other_subtypes << persist::asset_subtype::SENSOR << "," << persist::asset_subtype::VM << ","
+                   << persist::asset_subtype::VIRTUAL << "," << persist::asset_subtype::RACKCONTROLLER;
+
+    std::string sql;
+    // sensor: parent 1 and parent 2 must be defined
+    sql += " ((" + c.subtype + " = " + std::to_string(persist::asset_subtype::SENSOR) + " AND " +
+           s_sensor_located(scope, c, yes) + ")";
+    // device with power chain: parent and power chain must be defined
+    sql += " OR (" + c.subtype + " IN (" + powerchain_subtypes.str() + ") AND ";
+    if (yes) {
+        sql += "(" + c.parent + " IS NOT NULL AND EXISTS" + s_power_chain(c) + "))";
+    } else {
+        sql += "(" + c.parent + " IS NULL OR NOT EXISTS" + s_power_chain(c) + "))";
+    }
+    // other device with no power chain: parent must be defined
+    sql += " OR (" + c.alias + ".id_type IN (" + located_types.str() + ") AND " + c.subtype + " NOT IN (" +
+           other_subtypes.str() + ") AND " + c.parent + (yes ? " IS NOT NULL" : " IS NULL") + ")) ";
+    return sql;
+}
+
+// s_configured_table: condition using the materialised state (see fty_common_db_asset_configured.h)
+// the state of assets without a row (dropped by the triggers of the table) is computed
+static std::string s_configured_table(AssetFilter::Scope scope, const Columns& c, bool yes)
+{
+    return " (" + c.alias +
+           ".id_asset_element IN"
+           "  (SELECT id_asset_element FROM t_bios_asset_configured WHERE configured = " +
+           (yes ? "1" : "0") +
+           ")"
+           "  OR (NOT EXISTS"
+           "   (SELECT * FROM t_bios_asset_configured AS m WHERE m.id_asset_element = " +
+           c.alias + ".id_asset_element) AND" + s_configured(scope, c, yes) + ")) ";
+}
+
+// s_group_column: column counted rows are grouped by, empty if not grouped
+static std::string s_group_column(AssetFilter::Aggregate aggregate, const Columns& c)
+{
+    switch (aggregate) {
+        case AssetFilter::Aggregate::Type:
+            return c.alias + ".id_type";
+        case AssetFilter::Aggregate::Subtype:
+            return c.subtype;
+        case AssetFilter::Aggregate::Status:
+            return c.alias + ".status";
+        case AssetFilter::Aggregate::Rows:
+        case AssetFilter::Aggregate::Count:
+            break;
+    }
+    return "";
+}
+
+static std::string s_sql(AssetFilter::Scope scope, AssetFilter::Aggregate aggregate, size_t containers,
+    size_t types, size_t subtypes, bool status, Without without, Configured configured, bool configured_table)
+{
+    Columns                  c = s_columns(scope);
+    std::string              sql;
+    std::vector<std::string> conditions;
+    std::string              group = s_group_column(aggregate, c);
+
+    if (aggregate == AssetFilter::Aggregate::Count) {
+        sql = " SELECT COUNT(*) FROM ";
+    } else if (!group.empty()) {
+        sql = " SELECT " + group + ", COUNT(*) FROM ";
+    }
+
+    if (scope == AssetFilter::Scope::Container) {
+        if (aggregate == AssetFilter::Aggregate::Rows) {
+            sql =
+                " SELECT "
+                "   v.name, "
+                "   v.id_asset_element as asset_id, "
+                "   v.id_asset_device_type as subtype_id, "
+                "   v.type_name as subtype_name, "
+                "   v.id_type as type_id "
+                " FROM ";
+        }
+        sql += " v_bios_asset_element_super_parent AS v";
+        conditions.push_back(
+            " :containerid in (v.id_parent1, v.id_parent2, v.id_parent3, "
+            "                  v.id_parent4, v.id_parent5, v.id_parent6, "
+            "                  v.id_parent7, v.id_parent8, v.id_parent9, "
+            "                  v.id_parent10) ");
+    } else if (scope == AssetFilter::Scope::Containers) {
+        // containers are rows of t_bios_asset_element, so an asset is returned once per requested container
+        // even if the list is padded with duplicate ids
+        if (aggregate == AssetFilter::Aggregate::Rows) {
+            sql =
+                " SELECT "
+                "   c.id_asset_element as container_id, "
+                "   v.name, "
+                "   v.id_asset_element as asset_id, "
+                "   v.id_asset_device_type as subtype_id, "
+                "   v.type_name as subtype_name, "
+                "   v.id_type as type_id "
+                " FROM ";
+        }
+        sql +=
+            " v_bios_asset_element_super_parent AS v"
+            " JOIN t_bios_asset_element AS c"
+            " ON c.id_asset_element in (v.id_parent1, v.id_parent2, v.id_parent3, "
+            "                           v.id_parent4, v.id_parent5, v.id_parent6, "
+            "                           v.id_parent7, v.id_parent8, v.id_parent9, "
+            "                           v.id_parent10) ";
+        conditions.push_back(" c.id_asset_element IN (" + DBSql::in_list("container", containers) + ") ");
+    } else {
+        if (aggregate == AssetFilter::Aggregate::Rows) {
+            sql =
+                " SELECT "
+                "   t.name, "
+                "   t.id_asset_element as asset_id, "
+                "   t.id_type as type_id, "
+                "   t.id_subtype as subtype_id "
+                " FROM ";
+        }
+        sql += " t_bios_asset_element AS t";
+    }
+
+    if (subtypes > 0) {
+        conditions.push_back(" " + c.subtype + " IN (" + DBSql::in_list("subtype", subtypes) + ") ");
+    }
+    if (types > 0) {
+        conditions.push_back(" " + c.alias + ".id_type IN (" + DBSql::in_list("type", types) + ") ");
+    }
+    if (status) {
+        conditions.push_back(" " + c.alias + ".status = :status ");
+    }
+    switch (without) {
+        case Without::None:
+            break;
+        case Without::Location:
+            conditions.push_back(" " + c.parent + " IS NULL ");
+            break;
+        case Without::Powerchain:
+            conditions.push_back(" NOT EXISTS" + s_power_chain(c));
+            break;
+        case Without::Attribute:
+            conditions.push_back(
+                " NOT EXISTS "
+                " (SELECT a.id_asset_element"
+                "  FROM t_bios_asset_ext_attributes AS a"
+                "  WHERE a.keytag = :without AND " +
+                c.alias + ".id_asset_element = a.id_asset_element) ");
+            break;
+    }
+    if (configured != Configured::Any) {
+        if (configured_table) {
+            conditions.push_back(s_configured_table(scope, c, configured == Configured::Yes));
+        } else {
+            conditions.push_back(s_configured(scope, c, configured == Configured::Yes));
+        }
+    }
+
+    for (size_t i = 0; i < conditions.size(); i++) {
+        sql += (i == 0 ? " WHERE" : " AND") + conditions[i];
+    }
+    if (!group.empty()) {
+        sql += " GROUP BY " + group;
+    }
+    return sql;
+}
+
+// s_bind_list: deduplicate values and pad them up to the bucket size with the last one
+static void s_bind_list(const std::vector<uint16_t>& values, const std::string& prefix,
+    std::vector<std::pair<std::string, uint32_t>>& numbers)
+{
+    std::set<uint16_t> unique(values.begin(), values.end());
+    size_t             bucket = s_bucket(unique.size());
+    size_t             i      = 0;
+    for (auto value : unique) {
+        numbers.emplace_back(DBSql::placeholder(prefix, i++), value);
+    }
+    while (i < bucket) {
+        numbers.emplace_back(DBSql::placeholder(prefix, i++), *unique.rbegin());
+    }
+}
+
+void AssetFilter::Plan::bind(tntdb::Statement& st) const
+{
+    for (const auto& it : numbers) {
+        st.set(it.first, it.second);
+    }
+    for (const auto& it : strings) {
+        st.set(it.first, it.second);
+    }
+}
+
+// s_compile: build statement for filter, containers are bound for the containers scope
+static AssetFilter::Plan s_compile(const AssetFilter& filter, AssetFilter::Scope scope,
+    AssetFilter::Aggregate aggregate, const std::vector<uint32_t>& containers)
+{
+    using Scope = AssetFilter::Scope;
+
+    const auto& types      = filter.types;
+    const auto& subtypes   = filter.subtypes;
+    const auto& status     = filter.status;
+    const auto& without    = filter.without;
+    const auto& configured = filter.configured;
+
+    Without without_kind = Without::None;
+    if (without == "location") {
+        without_kind = Without::Location;
+    } else if (without == "powerchain") {
+        without_kind = Without::Powerchain;
+    } else if (!without.empty()) {
+        without_kind = Without::Attribute;
+    }
+
+    Configured configured_kind = Configured::Any;
+    if (configured == "yes") {
+        configured_kind = Configured::Yes;
+    } else if (configured == "no") {
+        configured_kind = Configured::No;
+    } else if (!configured.empty() && configured != "all") {
+        // note: the value "all" deactivate the option
+        log_error("bad value for configured option: %s (no, yes or all)", configured.c_str());
+    }
+
+    AssetFilter::Plan plan;
+    std::set<uint32_t> unique_containers(containers.begin(), containers.end());
+    size_t             containers_bucket = s_bucket(unique_containers.size());
+    size_t             i                 = 0;
+    for (auto id : unique_containers) {
+        plan.numbers.emplace_back(DBSql::placeholder("container", i++), id);
+    }
+    while (i < containers_bucket) {
+        plan.numbers.emplace_back(DBSql::placeholder("container", i++), *unique_containers.rbegin());
+    }
+    s_bind_list(subtypes, "subtype", plan.numbers);
+    s_bind_list(types, "type", plan.numbers);
+    if (!status.empty()) {
+        plan.strings.emplace_back("status", status);
+    }
+    if (without_kind == Without::Attribute) {
+        plan.strings.emplace_back("without", without);
+    }
+
+    size_t types_bucket     = s_bucket(std::set<uint16_t>(types.begin(), types.end()).size());
+    size_t subtypes_bucket  = s_bucket(std::set<uint16_t>(subtypes.begin(), subtypes.end()).size());
+    bool   configured_table = configured_kind != Configured::Any && DBConfigured::enabled();
+
+    std::ostringstream shape;
+    shape << "scope=" << int(scope) << ";containers=" << containers_bucket << ";aggregate=" << int(aggregate)
+          << ";types=" << types_bucket << ";subtypes=" << subtypes_bucket << ";status=" << !status.empty()
+          << ";without=" << int(without_kind) << ";configured=" << int(configured_kind)
+          << (configured_table ? ";materialised" : "");
+    plan.shape = shape.str();
+
+    static std::mutex                         s_mutex;
+    static std::map<std::string, std::string> s_shapes; // sql of each shape, guarded by s_mutex
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto                        it = s_shapes.find(plan.shape);
+    if (it == s_shapes.end()) {
+        it = s_shapes
+                 .emplace(plan.shape,
+                     s_sql(scope, aggregate, containers_bucket, types_bucket, subtypes_bucket, !status.empty(),
+                         without_kind, configured_kind, configured_table))
+                 .first;
+    }
+    plan.sql   = it->second;
+    plan.where = scope != Scope::All || types_bucket > 0 || subtypes_bucket > 0 || !status.empty() ||
+                 without_kind != Without::None || configured_kind != Configured::Any;
+    return plan;
+}
+
+AssetFilter::Plan AssetFilter::compile(Scope scope, Aggregate aggregate) const
+{
+    if (scope == Scope::Containers) {
+        throw std::invalid_argument("containers scope needs a list of containers");
+    }
+    return s_compile(*this, scope, aggregate, {});
+}
+
+AssetFilter::Plan AssetFilter::compile(const std::vector<uint32_t>& containers, Aggregate aggregate) const
+{
+    if (containers.empty()) {
+        throw std::invalid_argument("empty list of containers");
+    }
+    return s_compile(*this, Scope::Containers, aggregate, containers);
+}
+
+std::string AssetPage::sql(const std::string& id_column, const std::string& name_column, bool where) const
+{
+    std::string sql;
+    if (sort == SortKey::Name) {
+        if (!after_name.empty()) {
+            sql += (where ? " WHERE " : " AND ") + name_column + " > :aftername ";
+        } else if (after_id != 0) {
+            sql += (where ? " WHERE " : " AND ") + name_column +
+                   " > (SELECT name FROM t_bios_asset_element WHERE id_asset_element = :afterid) ";
+        }
+        sql += " ORDER BY " + name_column;
+    } else {
+        if (after_id != 0) {
+            sql += (where ? " WHERE " : " AND ") + id_column + " > :afterid ";
+        }
+        sql += " ORDER BY " + id_column;
+    }
+    return sql + " LIMIT :limit";
+}
+
+void AssetPage::bind(tntdb::Statement& st) const
+{
+    if (sort == SortKey::Name && !after_name.empty()) {
+        st.set("aftername", after_name);
+    } else if (after_id != 0) {
+        st.set("afterid", after_id);
+    }
+    st.set("limit", limit);
+}
+
+} // namespace DBAssets
+
+namespace DBConfigured {
+
+std::string condition(bool yes)
+{
+    return DBAssets::s_configured(
+        DBAssets::AssetFilter::Scope::Container, DBAssets::s_columns(DBAssets::AssetFilter::Scope::Container), yes);
+}
+
+} // namespace DBConfigured
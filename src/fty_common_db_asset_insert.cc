@@ -27,6 +27,9 @@
 */
 
 #include "fty_common_db.h"
+#include "fty_common_db_change.h"
+#include "fty_common_db_sql.h"
+#include "fty_common_db_suffix.h"
 #include <fty_common.h>
 #include <fty_common_db_dbpath.h>
 #include <fty_common_db_defs.h>
@@ -37,8 +40,6 @@
 #include <tntdb/row.h>
 #include <tntdb/transaction.h>
 
-#define MAX_CREATE_RETRY 10
-
 namespace DBAssetsInsert {
 
 static const std::string ins_upd_ass_ext_att_QUERY =
@@ -120,6 +121,8 @@ static db_reply_t insert_into_asset_ext_attribute_template(tntdb::Connection& co
                 .set("element", asset_element_id)
                 .execute();
         newid = uint32_t(conn.lastInsertId());
+        DBChange::record(conn, "t_bios_asset_ext_attributes", n == 2 ? DBChange::Op::Update : DBChange::Op::Insert,
+            asset_element_id, n);
         log_debug("was inserted %" PRIu32 " rows", n);
         ret.affected_rows = n;
         ret.rowid         = newid;
@@ -171,83 +174,11 @@ db_reply_t insert_into_asset_ext_attribute(
     }
 }
 
-// sql_plac: generate the placeholder name
-// example: sql_plac(2, 3) -> "item2_3";
-static std::string sql_plac(size_t i, size_t j)
-{
-    return "item" + std::to_string(i) + "_" + std::to_string(j);
-}
-
-// multi_insert_string: generate the SQL string for multivalue insert
-// Example:
-// multi_insert_string("INSERT INTO t_bios_foo", 2, 3, "ON DUPLICATE KEY ....") ->
-// 'INSERT INTO t_bios_foo (foo, bar)
-// VALUES(:item0_0, :item0_1),
-// (:item1_0, :item1_1),
-// (:item2_0, :item2_1)
-//  ON DUPLICATE KEY UPDATE ...'
-static std::string multi_insert_string(
-    const std::string& sql_header, size_t tuple_len, size_t items_len, const std::string& sql_postfix)
-{
-    std::stringstream s{};
-
-    s << sql_header;
-    s << "\nVALUES ";
-    for (size_t i = 0; i != items_len; i++) {
-        s << "(";
-        for (size_t j = 0; j != tuple_len; j++) {
-            s << ":" << sql_plac(i, j);
-            if (j < tuple_len - 1)
-                s << ", ";
-        }
-        if (i < items_len - 1)
-            s << "),\n";
-        else
-            s << ")\n";
-    }
-    s << sql_postfix;
-    return s.str();
-}
-
-// generate the proper tntdb::Statement for multi value insert for extended attributes
-static tntdb::Statement s_multi_insert_statement(
-    tntdb::Connection& conn, uint32_t element_id, bool read_only, zhash_t* attributes)
-{
-    static const std::string sql_header =
-        "INSERT INTO "
-        "   t_bios_asset_ext_attributes (keytag, value, id_asset_element, read_only) ";
-    static const std::string sql_postfix =
-        " ON DUPLICATE KEY "
-        "   UPDATE "
-        "       id_asset_ext_attribute = LAST_INSERT_ID(id_asset_ext_attribute) ";
-    auto sql = multi_insert_string(sql_header, 4, zhash_size(attributes), sql_postfix);
-
-    log_debug("sql: '%s'", sql.c_str());
-    auto st = conn.prepare(sql);
-
-    char*  value = static_cast<char*>(zhash_first(attributes)); // first value
-    size_t i     = 0;
-    while (value != nullptr) {
-        char* key = const_cast<char*>(zhash_cursor(attributes)); // key of this value
-        st.set(sql_plac(i, 0), key);
-        st.set(sql_plac(i, 1), value);
-        st.set(sql_plac(i, 2), element_id);
-        st.set(sql_plac(i, 3), read_only);
-        value = static_cast<char*>(zhash_next(attributes)); // next value
-        i++;
-    }
-
-    return st;
-}
-
 db_reply_t insert_into_asset_ext_attributes(
     tntdb::Connection& conn, uint32_t element_id, zhash_t* attributes, bool read_only, std::string& /*err*/)
 {
-    LOG_START;
-    size_t i = 0;
-
-    db_reply_t ret = db_reply_new();
     if (!attributes) {
+        db_reply_t ret = db_reply_new();
         ret.status     = 0;
         ret.errtype    = DB_ERR;
         ret.errsubtype = DB_ERROR_BADINPUT;
@@ -255,7 +186,23 @@ db_reply_t insert_into_asset_ext_attributes(
         log_error("end: %s, %s", "ignore insert", ret.msg.c_str());
         return ret;
     }
-    if (zhash_size(attributes) == 0) {
+
+    std::vector<ext_attribute_view_t> views;
+    for (char* value = static_cast<char*>(zhash_first(attributes)); value != nullptr;
+         value       = static_cast<char*>(zhash_next(attributes))) {
+        views.emplace_back(zhash_cursor(attributes), value);
+    }
+    return insert_into_asset_ext_attributes(conn, element_id, views, read_only);
+}
+
+db_reply_t insert_into_asset_ext_attributes(tntdb::Connection& conn, uint32_t element_id,
+    const std::vector<ext_attribute_view_t>& attributes, bool read_only)
+{
+    LOG_START;
+    size_t i = 0;
+
+    db_reply_t ret = db_reply_new();
+    if (attributes.empty()) {
         ret.status     = 0;
         ret.errtype    = DB_ERR;
         ret.errsubtype = DB_ERROR_BADINPUT;
@@ -264,9 +211,30 @@ db_reply_t insert_into_asset_ext_attributes(
         return ret;
     }
 
+    static const std::string sql_header =
+        "INSERT INTO "
+        "   t_bios_asset_ext_attributes (keytag, value, id_asset_element, read_only) ";
+    static const std::string sql_postfix =
+        " ON DUPLICATE KEY "
+        "   UPDATE "
+        "       id_asset_ext_attribute = LAST_INSERT_ID(id_asset_ext_attribute) ";
+
     try {
-        auto st = s_multi_insert_statement(conn, element_id, read_only, attributes);
-        i       = st.execute();
+        // a few chunk sizes only, so statements can be cached
+        size_t done = 0;
+        for (size_t size : DBSql::chunks(attributes.size())) {
+            auto st = conn.prepareCached(DBSql::multi_insert(sql_header, 4, size, sql_postfix));
+            for (size_t n = 0; n < size; n++) {
+                const auto& attribute = attributes[done + n];
+                st.setString(DBSql::multi_placeholder(n, 0), attribute.first);
+                st.setString(DBSql::multi_placeholder(n, 1), attribute.second);
+                st.set(DBSql::multi_placeholder(n, 2), element_id);
+                st.set(DBSql::multi_placeholder(n, 3), read_only);
+            }
+            i += st.execute();
+            done += size;
+        }
+        DBChange::record(conn, "t_bios_asset_ext_attributes", DBChange::Op::Insert, element_id, i);
         log_debug("%zu attributes written", i);
         ret.status = 1;
         LOG_END;
@@ -284,17 +252,6 @@ db_reply_t insert_into_asset_ext_attributes(
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
 
-static std::string grp_values(std::set<uint32_t> const& groups, uint32_t asset_element_id)
-{
-    std::string result = "  ";
-    for (auto& grp : groups) {
-        result = result + "(" + std::to_string(grp) + "," + std::to_string(asset_element_id) + ")" + ",";
-    }
-    // need to remove last ","
-    result.back() = ' ';
-    return result;
-}
-
 db_reply_t insert_asset_element_into_asset_group(tntdb::Connection& conn, uint32_t group_id, uint32_t asset_element_id)
 {
     LOG_START;
@@ -343,6 +300,8 @@ db_reply_t insert_asset_element_into_asset_group(tntdb::Connection& conn, uint32
 
         ret.affected_rows = st.set("group", group_id).set("element", asset_element_id).execute();
         ret.rowid         = uint32_t(conn.lastInsertId());
+        DBChange::record(
+            conn, "t_bios_asset_group_relation", DBChange::Op::Insert, asset_element_id, ret.affected_rows);
         log_debug("[t_bios_asset_group_relation]: was inserted %" PRIu64 " rows", ret.affected_rows);
         ret.status = 1;
         LOG_END;
@@ -382,14 +341,21 @@ db_reply_t insert_element_into_groups(
     log_debug("input parameters are correct");
 
     try {
-        tntdb::Statement st = conn.prepare(
-            " INSERT INTO"
-            "   t_bios_asset_group_relation"
-            "   (id_asset_group, id_asset_element)"
-            " VALUES " +
-            grp_values(groups, asset_element_id));
-
-        ret.affected_rows = st.execute();
+        std::vector<uint32_t> list(groups.begin(), groups.end());
+
+        size_t done = 0;
+        for (size_t size : DBSql::chunks(list.size())) {
+            tntdb::Statement st = conn.prepareCached(DBSql::multi_insert(
+                " INSERT INTO t_bios_asset_group_relation (id_asset_group, id_asset_element) ", 2, size, ""));
+            for (size_t i = 0; i < size; i++) {
+                st.set(DBSql::multi_placeholder(i, 0), list[done + i]);
+                st.set(DBSql::multi_placeholder(i, 1), asset_element_id);
+            }
+            ret.affected_rows += st.execute();
+            done += size;
+        }
+        DBChange::record(
+            conn, "t_bios_asset_group_relation", DBChange::Op::Insert, asset_element_id, ret.affected_rows);
         log_debug("[t_bios_asset_group_relation]: was inserted %" PRIu64 " rows", ret.affected_rows);
 
         if (ret.affected_rows == groups.size()) {
@@ -493,6 +459,7 @@ db_reply_t insert_into_asset_link(tntdb::Connection& conn, uint32_t asset_elemen
                                 .execute();
 
         ret.rowid = uint32_t(conn.lastInsertId());
+        DBChange::record(conn, "t_bios_asset_link", DBChange::Op::Insert, asset_element_dest_id, ret.affected_rows);
         log_debug("[t_bios_asset_link]: was inserted %" PRIu64 " rows", ret.affected_rows);
         ret.status = 1;
         LOG_END;
@@ -507,59 +474,59 @@ db_reply_t insert_into_asset_link(tntdb::Connection& conn, uint32_t asset_elemen
     }
 }
 
-db_reply_t insert_into_new_asset_links(tntdb::Connection& conn, std::vector<new_link_t> const& links)
+// outcome of the whole batch as the loop over insert_into_asset_link used to report it
+static db_reply_t s_links_reply(const db_reply<std::vector<db_link_insert_t>>& bulk, size_t count)
 {
-    std::vector<link_t> oldLinks;
-
-    for (const auto& l : links) {
-        link_t oldLink;
+    db_reply_t ret = db_reply_new();
+    for (const auto& one_link : bulk.item) {
+        if (one_link.status == 1)
+            ret.affected_rows++;
+    }
+    if (ret.affected_rows == count) {
+        ret.status = 1;
+        log_debug("all links were inserted successfully");
+    } else {
+        ret.status  = 0;
+        ret.errtype = INTERNAL_ERR;
+        log_error("end: %s", "not all links were inserted");
+    }
+    return ret;
+}
 
-        oldLink.src     = uint32_t(DBAssets::name_to_asset_id(l.src));
-        oldLink.dest    = uint32_t(DBAssets::name_to_asset_id(l.dest));
-        oldLink.src_out = l.src_out;
-        oldLink.dest_in = l.dest_in;
-        oldLink.type    = l.type;
+db_reply_t insert_into_new_asset_links(tntdb::Connection& conn, std::vector<new_link_t> const& links)
+{
+    LOG_START;
 
-        oldLinks.emplace_back(oldLink);
+    if (links.empty()) {
+        log_debug("nothing to insert");
+        db_reply_t ret = db_reply_new();
+        ret.status     = 1;
+        LOG_END;
+        return ret;
     }
 
-    return insert_into_asset_links(conn, oldLinks);
+    db_reply_t ret = s_links_reply(insert_new_asset_links(conn, links), links.size());
+    LOG_END;
+    return ret;
 }
 
 db_reply_t insert_into_asset_links(tntdb::Connection& conn, std::vector<link_t> const& links)
 {
     LOG_START;
 
-    db_reply_t ret = db_reply_new();
-
     // input parameters control
     if (links.empty()) {
         log_debug("nothing to insert");
-        ret.status = 1;
+        db_reply_t ret = db_reply_new();
+        ret.status     = 1;
         LOG_END;
         // actually, if there is nothing to insert, then insert was ok :)
         return ret;
     }
-    log_debug("input parameters are correct");
 
-    for (auto& one_link : links) {
-        auto ret_internal = DBAssetsInsert::insert_into_asset_link(
-            conn, one_link.src, one_link.dest, uint8_t(one_link.type), one_link.src_out, one_link.dest_in);
-        if (ret_internal.status == 1)
-            ret.affected_rows++;
-    }
-    if (ret.affected_rows == links.size()) {
-        ret.status = 1;
-        log_debug("all links were inserted successfully");
-        LOG_END;
-        return ret;
-    } else {
-        ret.status  = 0;
-        ret.errtype = INTERNAL_ERR;
-        log_error("end: %s", "not all links were inserted");
-        LOG_END;
-        return ret;
-    }
+    db_reply_t ret = s_links_reply(insert_asset_links(conn, links), links.size());
+    LOG_END;
+    return ret;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -614,51 +581,15 @@ db_reply_t insert_into_asset_element(tntdb::Connection& conn, const char* elemen
                 " (:name, :id_type, :id_subtype, :id_parent, :status, :priority, :asset_tag) "
                 " ON DUPLICATE KEY UPDATE name = :name ");
         } else {
-            timeval t;
-
-            bool        valid = false;
-            std::string indexStr;
-
-            unsigned retry = 0;
-
-            while (!valid && (retry++ < MAX_CREATE_RETRY)) {
-                gettimeofday(&t, nullptr);
-                srand(static_cast<unsigned int>(t.tv_sec * t.tv_usec));
-                // generate 8 digit random integer
-                unsigned long index = static_cast<unsigned long>(rand()) % static_cast<unsigned long>(100000000);
-
-                indexStr = std::to_string(index);
-                // create 8 digit index with leading zeros
-                indexStr = std::string(8 - indexStr.length(), '0') + indexStr;
-
-                log_debug("Checking ID %s validity", indexStr.c_str());
-
-                auto q = conn.prepare(R"(
-                    SELECT COUNT(id_asset_element) as cnt
-                    FROM t_bios_asset_element
-                    WHERE name like :name
-                )");
-
-                q.set("name", "%" + indexStr);
-
-                try {
-                    int res = q.selectValue().getInt();
-                    valid   = (res == 0);
-                } catch (const std::exception& e) {
-                    throw std::runtime_error(e.what());
-                }
-            }
-
-            if (!valid) {
-                throw std::runtime_error("Multiple Asset ID collisions - impossible to create asset");
-            }
+            std::string suffix = fty::db::SuffixAllocator::next(conn);
+            log_debug("Using ID %s", suffix.c_str());
 
             statement = conn.prepareCached(
                 " INSERT INTO t_bios_asset_element "
                 " (name, id_type, id_subtype, id_parent, status, priority, asset_tag) "
                 " VALUES "
-                " (concat (:name, '-', \"" +
-                indexStr + "\"), :id_type, :id_subtype, :id_parent, :status, :priority, :asset_tag) ");
+                " (concat (:name, '-', :suffix), :id_type, :id_subtype, :id_parent, :status, :priority, :asset_tag) ");
+            statement.set("suffix", suffix);
         }
         if (parent_id == 0) {
             ret.affected_rows = statement.set("name", element_name)
@@ -681,6 +612,7 @@ db_reply_t insert_into_asset_element(tntdb::Connection& conn, const char* elemen
         }
 
         ret.rowid = uint32_t(conn.lastInsertId());
+        DBChange::record(conn, "t_bios_asset_element", DBChange::Op::Insert, uint32_t(ret.rowid), ret.affected_rows);
         log_debug("[t_bios_asset_element]: was inserted %" PRIu64 " rows", ret.affected_rows);
 
         if (ret.affected_rows == 0) {
@@ -737,6 +669,7 @@ db_reply_t insert_into_monitor_asset_relation(tntdb::Connection& conn, uint16_t
 
         ret.affected_rows = st.set("monitor", monitor_id).set("asset", element_id).execute();
         ret.rowid         = uint32_t(conn.lastInsertId());
+        DBChange::record(conn, "t_bios_monitor_asset_relation", DBChange::Op::Insert, element_id, ret.affected_rows);
         log_debug("[t_bios_monitor_asset_relation]: was inserted %" PRIu64 " rows", ret.affected_rows);
         ret.status = 1;
         LOG_END;
@@ -768,6 +701,7 @@ db_reply_t insert_into_monitor_device(tntdb::Connection& conn, uint16_t device_t
         ret.affected_rows = st.set("name", device_name).set("iddevicetype", device_type_id).execute();
         log_debug("[t_bios_discovered_device]: was inserted %" PRIu64 " rows", ret.affected_rows);
         ret.rowid  = uint32_t(conn.lastInsertId());
+        DBChange::record(conn, "t_bios_discovered_device", DBChange::Op::Insert, 0, ret.affected_rows);
         ret.status = 1;
         LOG_END;
         return ret;
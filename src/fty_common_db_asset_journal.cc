@@ -0,0 +1,370 @@
+/*  =========================================================================
+    fty_common_db_asset_journal - Journal of asset changes
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_asset_journal - Journal of asset changes
+@discuss
+@end
+*/
+
+#include "fty_common_db_asset_journal.h"
+#include "fty_common_db_change.h"
+#include "fty_common_db_configured.h"
+#include "fty_common_db_session.h"
+#include "fty_common_db_sql.h"
+#include <algorithm>
+#include <atomic>
+#include <fty_log.h>
+#include <set>
+#include <tntdb/connect.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+namespace DBAssets {
+
+// maximal number of changes deleted by one statement of prune_change_journal
+static const uint64_t PRUNE_CHUNK = 10000;
+
+// journaling is enabled by enable_change_journal, once the table is known to exist
+static std::atomic<bool> s_journal_enabled{false};
+
+// s_prune_chunk: delete the oldest changes out of limits, at most PRUNE_CHUNK of them
+static uint64_t s_prune_chunk(tntdb::Connection& conn, uint32_t max_age, uint64_t max_rows)
+{
+    // newest change to delete, found by consistent reads (no locks) and deleted by primary key range
+    uint64_t last = 0;
+    if (max_rows != 0) {
+        tntdb::Result result = conn.prepareCached(
+                                       " SELECT"
+                                       "   id_change"
+                                       " FROM"
+                                       "   t_bios_asset_change_journal"
+                                       " ORDER BY id_change DESC"
+                                       " LIMIT 1 OFFSET :rows")
+                                   .set("rows", max_rows)
+                                   .select();
+        for (const auto& row : result) {
+            row[0].get(last);
+        }
+    }
+    if (max_age != 0) {
+        uint64_t aged = 0;
+        conn.prepareCached(
+                " SELECT"
+                "   COALESCE(MAX(id_change), 0)"
+                " FROM"
+                "   t_bios_asset_change_journal"
+                " WHERE"
+                "   changed_at < NOW() - INTERVAL :age SECOND")
+            .set("age", max_age)
+            .selectRow()[0]
+            .get(aged);
+        last = std::max(last, aged);
+    }
+    if (last == 0) {
+        return 0;
+    }
+    return conn.prepareCached(
+                   " DELETE FROM t_bios_asset_change_journal"
+                   " WHERE"
+                   "   id_change <= :last"
+                   " ORDER BY id_change"
+                   " LIMIT " +
+                   std::to_string(PRUNE_CHUNK))
+        .set("last", last)
+        .execute();
+}
+
+int enable_change_journal(tntdb::Connection& conn)
+{
+    LOG_START;
+    try {
+        // the table is created by the schema migration, never by the library
+        conn.prepareCached(" SELECT COUNT(*) FROM t_bios_asset_change_journal WHERE id_change = 0").selectValue();
+        s_journal_enabled = true;
+        LOG_END;
+        return 0;
+    } catch (const std::exception& e) {
+        log_error("change journal not enabled, t_bios_asset_change_journal cannot be read (schema migration "
+                  "0002_asset_change_journal.sql not applied?): %s",
+            e.what());
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
+void disable_change_journal()
+{
+    s_journal_enabled = false;
+}
+
+bool change_journal_enabled()
+{
+    return s_journal_enabled;
+}
+
+int64_t prune_change_journal(tntdb::Connection& conn, uint32_t max_age, uint64_t max_rows)
+{
+    LOG_START;
+    try {
+        uint64_t deleted = 0;
+        uint64_t n       = 0;
+        do {
+            n = s_prune_chunk(conn, max_age, max_rows);
+            deleted += n;
+        } while (n == PRUNE_CHUNK);
+        log_debug("[t_bios_asset_change_journal]: were deleted %" PRIu64 " rows", deleted);
+        LOG_END;
+        return int64_t(deleted);
+    } catch (const std::exception& e) {
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
+int64_t select_last_change_revision(tntdb::Connection& conn)
+{
+    LOG_START;
+    try {
+        tntdb::Row row = conn.prepareCached(
+                                 " SELECT"
+                                 "   COALESCE(MAX(id_change), 0)"
+                                 " FROM"
+                                 "   t_bios_asset_change_journal")
+                             .selectRow();
+
+        uint64_t revision = 0;
+        row[0].get(revision);
+        LOG_END;
+        return int64_t(revision);
+    } catch (const std::exception& e) {
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
+fty::db::Result<std::vector<db_asset_change_t>> read_changes_since(
+    tntdb::Connection& conn, uint64_t revision, uint32_t limit)
+{
+    LOG_START;
+
+    std::vector<db_asset_change_t> item;
+
+    try {
+        tntdb::Statement st = conn.prepareCached(
+            " SELECT"
+            "   id_change, id_asset_element, table_name, operation"
+            " FROM"
+            "   t_bios_asset_change_journal"
+            " WHERE"
+            "   id_change > :revision"
+            " ORDER BY id_change"
+            " LIMIT :limit");
+
+        tntdb::Result result = st.set("revision", revision).set("limit", limit).select();
+
+        item.reserve(result.size());
+        for (const auto& row : result) {
+            db_asset_change_t change{0, 0, "", ""};
+            row[0].get(change.revision);
+            row[1].get(change.asset_id);
+            row[2].get(change.table);
+            row[3].get(change.operation);
+            item.push_back(std::move(change));
+        }
+        LOG_END;
+        return item;
+    } catch (const std::exception& e) {
+        LOG_END_ABNORMAL(e);
+        return fty::db::Result<std::vector<db_asset_change_t>>::failure(DB_ERR, DB_ERROR_INTERNAL, e.what());
+    }
+}
+
+db_reply<std::vector<db_asset_change_t>> select_changes_since(
+    tntdb::Connection& conn, uint64_t revision, uint32_t limit)
+{
+    return read_changes_since(conn, revision, limit).toReply();
+}
+
+} // namespace DBAssets
+
+namespace DBChange {
+
+// s_journal_many_sql: journal insert of bucket assets, padding repeats the last id and is removed by DISTINCT
+static std::string s_journal_many_sql(size_t bucket)
+{
+    std::string ids;
+    for (size_t i = 0; i < bucket; i++) {
+        ids += (i == 0 ? " SELECT :" : " UNION ALL SELECT :") + DBSql::placeholder("id", i) + (i == 0 ? " AS id" : "");
+    }
+    return " INSERT INTO t_bios_asset_change_journal"
+           "   (id_asset_element, table_name, operation)"
+           " SELECT DISTINCT"
+           "   ids.id, :table, :operation"
+           " FROM"
+           "   (" + ids + ") AS ids";
+}
+
+// s_journal_ids: journal changes of assets in table, one statement per 256 of them
+static void s_journal_ids(tntdb::Connection& conn, const std::string& table, Op op, const std::vector<uint32_t>& ids)
+{
+    for (size_t offset = 0; offset < ids.size(); offset += DBSql::CHUNK_SIZE) {
+        size_t count  = std::min(DBSql::CHUNK_SIZE, ids.size() - offset);
+        size_t bucket = DBSql::chunk_bucket(count);
+
+        tntdb::Statement st = conn.prepareCached(s_journal_many_sql(bucket));
+        for (size_t i = 0; i < bucket; i++) {
+            st.set(DBSql::placeholder("id", i), ids[offset + std::min(i, count - 1)]);
+        }
+        st.set("table", table).set("operation", op_to_string(op)).execute();
+    }
+}
+
+// s_journal_name: journal change of asset identified by internal name
+static void s_journal_name(tntdb::Connection& conn, const std::string& table, Op op, const std::string& name)
+{
+    conn.prepareCached(
+            " INSERT INTO t_bios_asset_change_journal"
+            "   (id_asset_element, table_name, operation)"
+            " SELECT"
+            "   id_asset_element, :table, :operation"
+            " FROM"
+            "   t_bios_asset_element"
+            " WHERE"
+            "   name = :name")
+        .set("name", name)
+        .set("table", table)
+        .set("operation", op_to_string(op))
+        .execute();
+}
+
+const char* op_to_string(Op op)
+{
+    return fty::db::ChangeNotifier::operationToString(op);
+}
+
+void journal(tntdb::Connection& conn, const std::vector<fty::db::ChangeEvent>& events)
+{
+    if (!DBAssets::s_journal_enabled || events.empty()) {
+        return;
+    }
+    // changes of assets grouped by table and operation, in order of their first change
+    std::vector<std::pair<std::pair<std::string, Op>, std::vector<uint32_t>>> groups;
+    std::vector<const fty::db::ChangeEvent*>                                  named;
+    for (const auto& event : events) {
+        if (event.assetId == 0) {
+            if (!event.assetName.empty()) {
+                named.push_back(&event);
+            }
+            continue;
+        }
+        auto key = std::make_pair(event.table, event.operation);
+        auto it  = std::find_if(groups.begin(), groups.end(), [&key](const auto& group) {
+            return group.first == key;
+        });
+        if (it == groups.end()) {
+            it = groups.insert(groups.end(), {key, {}});
+        }
+        it->second.push_back(event.assetId);
+    }
+
+    try {
+        for (auto& [key, ids] : groups) {
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+            s_journal_ids(conn, key.first, key.second, ids);
+        }
+        for (const auto* event : named) {
+            s_journal_name(conn, event->table, event->operation, event->assetName);
+        }
+    } catch (const std::exception& e) {
+        log_error("%zu changes were not journaled: %s", events.size(), e.what());
+        if (DBSession::deadlock(e) || DBSession::lock_wait_timeout(e)) {
+            throw;
+        }
+    }
+}
+
+void record(tntdb::Connection& conn, const std::string& table, Op op, uint32_t asset_id, uint64_t affected_rows)
+{
+    if (affected_rows == 0) {
+        return;
+    }
+    fty::db::ChangeNotifier::invalidate(table);
+    fty::db::ChangeNotifier::notify({asset_id, "", table, op});
+    if (table == "t_bios_asset_element" || table == "t_bios_asset_link") {
+        DBConfigured::refresh(conn, asset_id);
+    }
+    if (asset_id != 0 && DBAssets::s_journal_enabled) {
+        fty::db::ChangeNotifier::journal(conn, {asset_id, "", table, op});
+    }
+}
+
+void record_many(tntdb::Connection& conn, const std::string& table, Op op, const std::vector<uint32_t>& asset_ids)
+{
+    std::set<uint32_t> unique(asset_ids.begin(), asset_ids.end());
+    unique.erase(0);
+    if (unique.empty()) {
+        return;
+    }
+    std::vector<uint32_t> ids(unique.begin(), unique.end());
+
+    fty::db::ChangeNotifier::invalidate(table);
+    for (uint32_t id : ids) {
+        fty::db::ChangeNotifier::notify({id, "", table, op});
+    }
+    if (table == "t_bios_asset_element" || table == "t_bios_asset_link") {
+        DBConfigured::refresh_many(conn, ids);
+    }
+    if (!DBAssets::s_journal_enabled) {
+        return;
+    }
+    if (fty::db::ChangeNotifier::deferring()) {
+        for (uint32_t id : ids) {
+            fty::db::ChangeNotifier::journal(conn, {id, "", table, op});
+        }
+        return;
+    }
+    try {
+        s_journal_ids(conn, table, op, ids);
+    } catch (const std::exception& e) {
+        log_error("changes of %zu assets in %s were not journaled: %s", ids.size(), table.c_str(), e.what());
+        if (DBSession::deadlock(e) || DBSession::lock_wait_timeout(e)) {
+            throw;
+        }
+    }
+}
+
+void record(
+    tntdb::Connection& conn, const std::string& table, Op op, const std::string& asset_name, uint64_t affected_rows)
+{
+    if (affected_rows == 0) {
+        return;
+    }
+    fty::db::ChangeNotifier::invalidate(table);
+    fty::db::ChangeNotifier::notify({0, asset_name, table, op});
+    if (DBAssets::s_journal_enabled) {
+        fty::db::ChangeNotifier::journal(conn, {0, asset_name, table, op});
+    }
+}
+
+} // namespace DBChange
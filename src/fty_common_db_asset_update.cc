@@ -27,10 +27,16 @@
 */
 
 #include "fty_common_db.h"
+#include "fty_common_db_change.h"
+#include "fty_common_db_sql.h"
 #include <fty_common.h>
+#include <fty_common_asset_types.h>
+#include <functional>
+#include <mutex>
 #include <tntdb/error.h>
 #include <tntdb/result.h>
 #include <tntdb/row.h>
+#include <tntdb/transaction.h>
 
 #define ERRCODE_ABNORMAL 1
 
@@ -73,6 +79,7 @@ int update_asset_element(tntdb::Connection& conn, uint32_t element_id, const cha
         } else {
             affected_rows = int(st.setNull("id_parent").execute());
         }
+        DBChange::record(conn, "t_bios_asset_element", DBChange::Op::Update, element_id, uint64_t(affected_rows));
         log_debug("[t_asset_element]: updated %" PRIu32 " rows", affected_rows);
         LOG_END;
         // if we are here and affected rows = 0 -> nothing was updated because
@@ -102,6 +109,7 @@ int update_asset_status_by_name(const char* element_name, const char* status)
         " WHERE name = :name");
 
     int32_t affected_rows = int32_t(st.set("name", element_name).set("status", status).execute());
+    DBChange::record(conn, "t_bios_asset_element", DBChange::Op::Update, element_name, uint64_t(affected_rows));
 
     if (affected_rows > 1) {
         log_error("Name %s should be unique", element_name);
@@ -113,4 +121,767 @@ int update_asset_status_by_name(const char* element_name, const char* status)
     return 0;
 }
 
+// s_write_ext_attributes: insert (or upsert) attributes with one multi-row statement per 256 of them
+static uint64_t s_write_ext_attributes(tntdb::Connection& conn, uint32_t element_id,
+    const std::map<std::string, std::string>& attributes, bool read_only, const std::string& postfix)
+{
+    std::vector<std::pair<std::string, std::string>> list(attributes.begin(), attributes.end());
+
+    uint64_t affected = 0;
+    size_t   done     = 0;
+    for (size_t size : DBSql::chunks(list.size())) {
+        tntdb::Statement st = conn.prepareCached(DBSql::multi_insert(
+            "INSERT INTO t_bios_asset_ext_attributes (keytag, value, id_asset_element, read_only) ", 4, size,
+            postfix));
+        for (size_t i = 0; i < size; i++) {
+            st.set(DBSql::multi_placeholder(i, 0), list[done + i].first);
+            st.set(DBSql::multi_placeholder(i, 1), list[done + i].second);
+            st.set(DBSql::multi_placeholder(i, 2), element_id);
+            st.set(DBSql::multi_placeholder(i, 3), read_only);
+        }
+        affected += st.execute();
+        done += size;
+    }
+    return affected;
+}
+
+// s_delete_ext_attributes: delete attributes with one statement per 256 keytags
+static uint64_t s_delete_ext_attributes(
+    tntdb::Connection& conn, uint32_t element_id, const std::set<std::string>& keytags)
+{
+    std::vector<std::string> list(keytags.begin(), keytags.end());
+
+    uint64_t affected = 0;
+    for (size_t offset = 0; offset < list.size(); offset += DBSql::CHUNK_SIZE) {
+        size_t count  = std::min(DBSql::CHUNK_SIZE, list.size() - offset);
+        size_t bucket = DBSql::chunk_bucket(count);
+
+        tntdb::Statement st = conn.prepareCached(
+            " DELETE FROM"
+            "   t_bios_asset_ext_attributes"
+            " WHERE"
+            "   id_asset_element = :element AND"
+            "   keytag IN (" +
+            DBSql::in_list("keytag", bucket) + ")");
+        st.set("element", element_id);
+        for (size_t i = 0; i < bucket; i++) {
+            st.set(DBSql::placeholder("keytag", i), list[offset + std::min(i, count - 1)]);
+        }
+        affected += st.execute();
+    }
+    return affected;
+}
+
+db_reply<db_ext_delta_t> apply_ext_attributes(tntdb::Connection& conn, uint32_t element_id,
+    const std::map<std::string, std::string>& desired, bool read_only)
+{
+    LOG_START;
+    log_debug("  element_id = %" PRIu32, element_id);
+    log_debug("  read_only = %i", read_only);
+
+    db_ext_delta_t           delta;
+    db_reply<db_ext_delta_t> ret = db_reply_new(delta);
+
+    // input parameters control
+    for (const auto& it : desired) {
+        if (!persist::is_ok_keytag(it.first.c_str()) || !persist::is_ok_value(it.second.c_str())) {
+            ret.status     = 0;
+            ret.errtype    = DB_ERR;
+            ret.errsubtype = DB_ERROR_BADINPUT;
+            ret.msg        = "unacceptable ext attribute '" + it.first + "'";
+            log_error("end: %s, %s", "ignore apply", ret.msg.c_str());
+            return ret;
+        }
+    }
+
+    try {
+        fty::db::ChangeNotifier::Deferral deferral;
+        tntdb::Transaction                trans(conn);
+
+        // current attributes, locked until commit
+        tntdb::Statement st = conn.prepareCached(
+            " SELECT"
+            "   keytag, value, read_only"
+            " FROM"
+            "   t_bios_asset_ext_attributes"
+            " WHERE"
+            "   id_asset_element = :element"
+            " FOR UPDATE");
+
+        std::map<std::string, std::pair<std::string, bool>> current;
+        for (const auto& row : st.set("element", element_id).select()) {
+            std::string keytag, value;
+            bool        ro = false;
+            row[0].get(keytag);
+            row[1].get(value);
+            row[2].get(ro);
+            current[keytag] = {value, ro};
+        }
+
+        for (const auto& it : current) {
+            if (it.second.second == read_only && desired.count(it.first) == 0) {
+                ret.item.deleted.insert(it.first);
+            }
+        }
+        for (const auto& it : desired) {
+            auto cur = current.find(it.first);
+            if (cur == current.end()) {
+                ret.item.inserted.insert(it);
+            } else if (cur->second.first != it.second || cur->second.second != read_only) {
+                ret.item.updated.insert(it);
+            }
+        }
+
+        uint64_t deleted  = s_delete_ext_attributes(conn, element_id, ret.item.deleted);
+        uint64_t inserted = s_write_ext_attributes(conn, element_id, ret.item.inserted, read_only, "");
+        // rows are known to exist, so this is a batched update by the unique key (keytag, id_asset_element)
+        s_write_ext_attributes(conn, element_id, ret.item.updated, read_only,
+            " ON DUPLICATE KEY UPDATE"
+            "   value = VALUES (value),"
+            "   read_only = VALUES (read_only)");
+
+        DBChange::record(conn, "t_bios_asset_ext_attributes", DBChange::Op::Delete, element_id, deleted);
+        DBChange::record(conn, "t_bios_asset_ext_attributes", DBChange::Op::Insert, element_id, inserted);
+        DBChange::record(
+            conn, "t_bios_asset_ext_attributes", DBChange::Op::Update, element_id, ret.item.updated.size());
+
+        deferral.prepare();
+        trans.commit();
+        deferral.commit();
+
+        ret.affected_rows = ret.item.deleted.size() + ret.item.inserted.size() + ret.item.updated.size();
+        log_debug("[t_bios_asset_ext_attributes]: %zu inserted, %zu updated, %zu deleted", ret.item.inserted.size(),
+            ret.item.updated.size(), ret.item.deleted.size());
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    } catch (const std::exception& e) {
+        ret.item       = db_ext_delta_t{};
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_INTERNAL;
+        ret.msg        = e.what();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+using Membership = std::pair<uint32_t, uint32_t>; // (group, element)
+
+// s_select_memberships: current memberships of elements (only in group, if not 0), locked until commit
+static std::set<Membership> s_select_memberships(
+    tntdb::Connection& conn, const std::vector<uint32_t>& elements, uint32_t group_id)
+{
+    std::set<Membership> found;
+    for (size_t offset = 0; offset < elements.size(); offset += DBSql::CHUNK_SIZE) {
+        size_t count  = std::min(DBSql::CHUNK_SIZE, elements.size() - offset);
+        size_t bucket = DBSql::chunk_bucket(count);
+
+        // two statements, so each one uses the best index and locks only the rows it reads
+        tntdb::Statement st = conn.prepareCached(
+            " SELECT"
+            "   id_asset_group, id_asset_element"
+            " FROM"
+            "   t_bios_asset_group_relation"
+            " WHERE" +
+            std::string(group_id != 0 ? "   id_asset_group = :group AND" : "") +
+            "   id_asset_element IN (" +
+            DBSql::in_list("element", bucket) +
+            ")"
+            " FOR UPDATE");
+        if (group_id != 0) {
+            st.set("group", group_id);
+        }
+        for (size_t i = 0; i < bucket; i++) {
+            st.set(DBSql::placeholder("element", i), elements[offset + std::min(i, count - 1)]);
+        }
+
+        for (const auto& row : st.select()) {
+            Membership m{0, 0};
+            row[0].get(m.first);
+            row[1].get(m.second);
+            found.insert(m);
+        }
+    }
+    return found;
+}
+
+// s_write_memberships: insert (or delete) memberships, one statement per 256 of them
+static uint64_t s_write_memberships(tntdb::Connection& conn, const std::vector<Membership>& list, bool insert)
+{
+    uint64_t affected = 0;
+    size_t   done     = 0;
+    for (size_t size : DBSql::chunks(list.size())) {
+        std::string sql;
+        if (insert) {
+            sql = DBSql::multi_insert(
+                " INSERT INTO t_bios_asset_group_relation (id_asset_group, id_asset_element) ", 2, size, "");
+        } else {
+            sql = " DELETE FROM t_bios_asset_group_relation WHERE (id_asset_group, id_asset_element) IN (";
+            for (size_t i = 0; i < size; i++) {
+                sql += (i > 0 ? ", (:" : "(:") + DBSql::multi_placeholder(i, 0) + ", :" +
+                       DBSql::multi_placeholder(i, 1) + ")";
+            }
+            sql += ")";
+        }
+
+        tntdb::Statement st = conn.prepareCached(sql);
+        for (size_t i = 0; i < size; i++) {
+            st.set(DBSql::multi_placeholder(i, 0), list[done + i].first);
+            st.set(DBSql::multi_placeholder(i, 1), list[done + i].second);
+        }
+        affected += st.execute();
+        done += size;
+    }
+    return affected;
+}
+
+// s_apply_memberships: write delta in a transaction, fill ret
+static void s_apply_memberships(tntdb::Connection& conn, const std::vector<uint32_t>& elements, uint32_t group_id,
+    const std::function<void(const std::set<Membership>&, db_group_delta_t&)>& diff, db_reply<db_group_delta_t>& ret)
+{
+    fty::db::ChangeNotifier::Deferral deferral;
+    tntdb::Transaction                trans(conn);
+
+    diff(s_select_memberships(conn, elements, group_id), ret.item);
+
+    s_write_memberships(conn, ret.item.removed, false);
+    s_write_memberships(conn, ret.item.added, true);
+
+    std::vector<uint32_t> removed, added;
+    for (const auto& m : ret.item.removed) {
+        removed.push_back(m.second);
+    }
+    for (const auto& m : ret.item.added) {
+        added.push_back(m.second);
+    }
+    DBChange::record_many(conn, "t_bios_asset_group_relation", DBChange::Op::Delete, removed);
+    DBChange::record_many(conn, "t_bios_asset_group_relation", DBChange::Op::Insert, added);
+
+    deferral.prepare();
+    trans.commit();
+    deferral.commit();
+
+    ret.affected_rows = ret.item.added.size() + ret.item.removed.size();
+    log_debug("[t_bios_asset_group_relation]: %zu inserted, %zu deleted", ret.item.added.size(),
+        ret.item.removed.size());
+    ret.status = 1;
+}
+
+db_reply<db_group_delta_t> set_group_membership(
+    tntdb::Connection& conn, uint32_t element_id, const std::set<uint32_t>& groups)
+{
+    return set_group_memberships(conn, {{element_id, groups}});
+}
+
+db_reply<db_group_delta_t> set_group_memberships(
+    tntdb::Connection& conn, const std::map<uint32_t, std::set<uint32_t>>& memberships)
+{
+    LOG_START;
+
+    db_group_delta_t           delta;
+    db_reply<db_group_delta_t> ret = db_reply_new(delta);
+
+    // input parameters control
+    std::vector<uint32_t> elements;
+    for (const auto& it : memberships) {
+        if (it.first == 0 || it.second.count(0) > 0) {
+            ret.status     = 0;
+            ret.errtype    = DB_ERR;
+            ret.errsubtype = DB_ERROR_BADINPUT;
+            ret.msg        = "0 value of asset_element_id or group_id is not allowed";
+            log_error("end: %s, %s", "ignore update", ret.msg.c_str());
+            return ret;
+        }
+        elements.push_back(it.first);
+    }
+    if (elements.empty()) {
+        log_debug("nothing to update");
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    }
+
+    try {
+        s_apply_memberships(conn, elements, 0,
+            [&memberships](const std::set<Membership>& current, db_group_delta_t& out) {
+                for (const auto& m : current) {
+                    if (memberships.at(m.second).count(m.first) == 0) {
+                        out.removed.push_back(m);
+                    }
+                }
+                for (const auto& it : memberships) {
+                    for (uint32_t group : it.second) {
+                        if (current.count({group, it.first}) == 0) {
+                            out.added.emplace_back(group, it.first);
+                        }
+                    }
+                }
+            },
+            ret);
+        LOG_END;
+        return ret;
+    } catch (const std::exception& e) {
+        ret.item       = db_group_delta_t{};
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_INTERNAL;
+        ret.msg        = e.what();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+}
+
+db_reply<db_group_delta_t> add_members(
+    tntdb::Connection& conn, uint32_t group_id, const std::vector<uint32_t>& element_ids)
+{
+    LOG_START;
+    log_debug("  group_id = %" PRIu32, group_id);
+
+    db_group_delta_t           delta;
+    db_reply<db_group_delta_t> ret = db_reply_new(delta);
+
+    // input parameters control
+    std::set<uint32_t> members(element_ids.begin(), element_ids.end());
+    if (group_id == 0 || members.count(0) > 0) {
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_BADINPUT;
+        ret.msg        = "0 value of asset_element_id or group_id is not allowed";
+        log_error("end: %s, %s", "ignore insert", ret.msg.c_str());
+        return ret;
+    }
+    if (members.empty()) {
+        log_debug("nothing to insert");
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    }
+
+    try {
+        s_apply_memberships(conn, std::vector<uint32_t>(members.begin(), members.end()), group_id,
+            [&members, group_id](const std::set<Membership>& current, db_group_delta_t& out) {
+                for (uint32_t element : members) {
+                    if (current.count({group_id, element}) == 0) {
+                        out.added.emplace_back(group_id, element);
+                    }
+                }
+            },
+            ret);
+        LOG_END;
+        return ret;
+    } catch (const std::exception& e) {
+        ret.item       = db_group_delta_t{};
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_INTERNAL;
+        ret.msg        = e.what();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+// s_count_active_power_devices: count active power devices, lock all power devices if lock is true
+static uint32_t s_count_active_power_devices(tntdb::Connection& conn, bool lock)
+{
+    static const std::string query =
+        " SELECT"
+        "   COALESCE(SUM(status = 'active'), 0)"
+        " FROM"
+        "   t_bios_asset_element"
+        " WHERE"
+        "   id_subtype IN (" +
+        DBSql::power_device_subtypes() + ")";
+
+    uint32_t count = 0;
+    conn.prepareCached(lock ? query + " FOR UPDATE" : query).selectValue().get(count);
+    return count;
+}
+
+db_reply<uint32_t> set_status_bulk(tntdb::Connection& conn, const std::vector<std::string>& names,
+    const std::string& status, int64_t max_active_power_devices)
+{
+    LOG_START;
+    log_debug("  count = %zu, status = '%s', limit = %" PRIi64, names.size(), status.c_str(), max_active_power_devices);
+
+    uint32_t           count = 0;
+    db_reply<uint32_t> ret   = db_reply_new(count);
+
+    // input parameters control
+    if (status != "active" && status != "nonactive") {
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_BADINPUT;
+        ret.msg        = "Invalid value of status " + status;
+        log_error("end: %s, %s", "ignore update", ret.msg.c_str());
+        return ret;
+    }
+
+    try {
+        fty::db::ChangeNotifier::Deferral deferral;
+        tntdb::Transaction                trans(conn);
+
+        uint32_t before = s_count_active_power_devices(conn, true);
+
+        // assets whose status really changes, locked until commit
+        std::vector<uint32_t>    ids;
+        std::vector<std::string> list(names.begin(), names.end());
+        for (size_t offset = 0; offset < list.size(); offset += DBSql::CHUNK_SIZE) {
+            size_t count  = std::min(DBSql::CHUNK_SIZE, list.size() - offset);
+            size_t bucket = DBSql::chunk_bucket(count);
+
+            tntdb::Statement st = conn.prepareCached(
+                " SELECT id_asset_element FROM t_bios_asset_element"
+                " WHERE status <> :status AND name IN (" +
+                DBSql::in_list("name", bucket) + ") FOR UPDATE");
+            st.set("status", status);
+            for (size_t i = 0; i < bucket; i++) {
+                st.set(DBSql::placeholder("name", i), list[offset + std::min(i, count - 1)]);
+            }
+            for (const auto& row : st.select()) {
+                uint32_t id = 0;
+                row[0].get(id);
+                ids.push_back(id);
+            }
+        }
+
+        for (size_t offset = 0; offset < ids.size(); offset += DBSql::CHUNK_SIZE) {
+            size_t count  = std::min(DBSql::CHUNK_SIZE, ids.size() - offset);
+            size_t bucket = DBSql::chunk_bucket(count);
+
+            tntdb::Statement st = conn.prepareCached(
+                " UPDATE t_bios_asset_element SET status = :status"
+                " WHERE id_asset_element IN (" +
+                DBSql::in_list("id", bucket) + ")");
+            st.set("status", status);
+            for (size_t i = 0; i < bucket; i++) {
+                st.set(DBSql::placeholder("id", i), ids[offset + std::min(i, count - 1)]);
+            }
+            ret.affected_rows += st.execute();
+        }
+
+        ret.item = s_count_active_power_devices(conn, false);
+        if (max_active_power_devices >= 0 && ret.item > before && int64_t(ret.item) > max_active_power_devices) {
+            trans.rollback();
+            ret.status        = 0;
+            ret.errtype       = DB_ERR;
+            ret.errsubtype    = DB_ERROR_BADINPUT;
+            ret.msg           = "Limit of " + std::to_string(max_active_power_devices) + " active power devices";
+            ret.item          = before;
+            ret.affected_rows = 0;
+            log_error("end: %s, %s", "ignore update", ret.msg.c_str());
+            return ret;
+        }
+
+        DBChange::record_many(conn, "t_bios_asset_element", DBChange::Op::Update, ids);
+
+        deferral.prepare();
+        trans.commit();
+        deferral.commit();
+
+        log_debug("[t_asset_element]: updated %" PRIu64 " rows, %" PRIu32 " active power devices", ret.affected_rows,
+            ret.item);
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    } catch (const std::exception& e) {
+        ret.item       = 0;
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_INTERNAL;
+        ret.msg        = e.what();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+// fields of db_asset_update_t, bit in mask and column
+enum UpdateField : unsigned
+{
+    UF_PARENT   = 1 << 0,
+    UF_STATUS   = 1 << 1,
+    UF_PRIORITY = 1 << 2,
+    UF_TAG      = 1 << 3,
+    UF_SUBTYPE  = 1 << 4
+};
+
+static const std::vector<std::pair<UpdateField, const char*>> s_update_columns = {
+    {UF_PARENT, "id_parent"},
+    {UF_STATUS, "status"},
+    {UF_PRIORITY, "priority"},
+    {UF_TAG, "asset_tag"},
+    {UF_SUBTYPE, "id_subtype"},
+};
+
+static unsigned s_update_mask(const db_asset_update_t& update)
+{
+    return (update.parent_id ? UF_PARENT : 0u) | (update.status ? UF_STATUS : 0u) |
+           (update.priority ? UF_PRIORITY : 0u) | (update.asset_tag ? UF_TAG : 0u) |
+           (update.subtype_id ? UF_SUBTYPE : 0u);
+}
+
+// s_update_sql: UPDATE joining rows of values, one per asset, memoised per mask and number of rows
+static const std::string& s_update_sql(unsigned mask, size_t rows)
+{
+    static std::mutex                                         mutex;
+    static std::map<std::pair<unsigned, size_t>, std::string> memo;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto&                       sql = memo[{mask, rows}];
+    if (!sql.empty()) {
+        return sql;
+    }
+
+    std::string values;
+    for (size_t i = 0; i < rows; i++) {
+        values += i == 0 ? " SELECT " : " UNION ALL SELECT ";
+        values += ":" + DBSql::multi_placeholder(i, 0) + " AS id";
+        for (size_t j = 0; j < s_update_columns.size(); j++) {
+            if (mask & s_update_columns[j].first) {
+                values += ", :" + DBSql::multi_placeholder(i, j + 1) + " AS " + s_update_columns[j].second;
+            }
+        }
+    }
+
+    std::string set;
+    for (const auto& column : s_update_columns) {
+        if (mask & column.first) {
+            set += std::string(set.empty() ? " " : ", ") + "t." + column.second + " = v." + column.second;
+        }
+    }
+
+    sql = " UPDATE t_bios_asset_element t JOIN (" + values + ") v ON t.id_asset_element = v.id SET" + set;
+    return sql;
+}
+
+// s_check_update: reason why update is unacceptable, empty if it is fine
+static std::string s_check_update(const db_asset_update_t& update)
+{
+    if (update.id == 0) {
+        return "0 value of asset_element_id is not allowed";
+    }
+    if (update.parent_id && *update.parent_id == update.id) {
+        return "asset cannot be its own parent";
+    }
+    if (update.status && *update.status != "active" && *update.status != "nonactive") {
+        return "Invalid value of status " + *update.status;
+    }
+    if (update.priority && (*update.priority < 1 || *update.priority > 5)) {
+        return "Invalid value of priority " + std::to_string(*update.priority);
+    }
+    return "";
+}
+
+// s_set_update: bind values of update to i-th row of s_update_sql
+static void s_set_update(tntdb::Statement& st, size_t i, const db_asset_update_t& update)
+{
+    st.set(DBSql::multi_placeholder(i, 0), update.id);
+    if (update.parent_id) {
+        if (*update.parent_id == 0) {
+            st.setNull(DBSql::multi_placeholder(i, 1));
+        } else {
+            st.set(DBSql::multi_placeholder(i, 1), *update.parent_id);
+        }
+    }
+    if (update.status) {
+        st.set(DBSql::multi_placeholder(i, 2), *update.status);
+    }
+    if (update.priority) {
+        st.set(DBSql::multi_placeholder(i, 3), *update.priority);
+    }
+    if (update.asset_tag) {
+        if (update.asset_tag->empty()) {
+            st.setNull(DBSql::multi_placeholder(i, 4));
+        } else {
+            st.set(DBSql::multi_placeholder(i, 4), *update.asset_tag);
+        }
+    }
+    if (update.subtype_id) {
+        uint16_t subtype = *update.subtype_id == 0 ? uint16_t(persist::asset_subtype::N_A) : *update.subtype_id;
+        st.set(DBSql::multi_placeholder(i, 5), subtype);
+    }
+}
+
+// s_select_current: current values of fields of assets, locked until commit
+// NULL parent and asset tag are returned as 0 and empty, as db_asset_update_t sets them
+static std::map<uint32_t, db_asset_update_t> s_select_current(tntdb::Connection& conn, const std::vector<uint32_t>& ids)
+{
+    std::map<uint32_t, db_asset_update_t> current;
+    for (size_t offset = 0; offset < ids.size(); offset += DBSql::CHUNK_SIZE) {
+        size_t count  = std::min(DBSql::CHUNK_SIZE, ids.size() - offset);
+        size_t bucket = DBSql::chunk_bucket(count);
+
+        tntdb::Statement st = conn.prepareCached(
+            " SELECT"
+            "   id_asset_element, COALESCE(id_parent, 0), status, priority, COALESCE(asset_tag, ''), id_subtype"
+            " FROM"
+            "   t_bios_asset_element"
+            " WHERE"
+            "   id_asset_element IN (" +
+            DBSql::in_list("id", bucket) +
+            ")"
+            " FOR UPDATE");
+        for (size_t i = 0; i < bucket; i++) {
+            st.set(DBSql::placeholder("id", i), ids[offset + std::min(i, count - 1)]);
+        }
+
+        for (const auto& row : st.select()) {
+            db_asset_update_t values;
+            uint32_t          parent_id = 0;
+            std::string       status, asset_tag;
+            uint16_t          priority = 0, subtype_id = 0;
+            row[0].get(values.id);
+            row[1].get(parent_id);
+            row[2].get(status);
+            row[3].get(priority);
+            row[4].get(asset_tag);
+            row[5].get(subtype_id);
+            values.parent_id  = parent_id;
+            values.status     = status;
+            values.priority   = priority;
+            values.asset_tag  = asset_tag;
+            values.subtype_id = subtype_id;
+            current.emplace(values.id, values);
+        }
+    }
+    return current;
+}
+
+// s_changes: true if update sets some field to another value than current
+static bool s_changes(const db_asset_update_t& update, const db_asset_update_t& current)
+{
+    uint16_t subtype = update.subtype_id && *update.subtype_id == 0 ? uint16_t(persist::asset_subtype::N_A)
+                                                                   : update.subtype_id.value_or(0);
+    return (update.parent_id && update.parent_id != current.parent_id) ||
+           (update.status && update.status != current.status) ||
+           (update.priority && update.priority != current.priority) ||
+           (update.asset_tag && update.asset_tag != current.asset_tag) ||
+           (update.subtype_id && subtype != current.subtype_id);
+}
+
+db_reply_t update_asset_element_fields(tntdb::Connection& conn, const db_asset_update_t& update)
+{
+    LOG_START;
+    log_debug("  element_id = %" PRIu32, update.id);
+
+    db_reply_t ret = db_reply_new();
+
+    std::string error = s_check_update(update);
+    if (!error.empty()) {
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_BADINPUT;
+        ret.msg        = error;
+        log_error("end: %s, %s", "ignore update", ret.msg.c_str());
+        return ret;
+    }
+    unsigned mask = s_update_mask(update);
+    if (mask == 0) {
+        log_debug("nothing to update");
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    }
+
+    try {
+        tntdb::Statement st = conn.prepareCached(s_update_sql(mask, 1));
+        s_set_update(st, 0, update);
+        ret.affected_rows = st.execute();
+        DBChange::record(conn, "t_bios_asset_element", DBChange::Op::Update, update.id, ret.affected_rows);
+        log_debug("[t_asset_element]: updated %" PRIu64 " rows", ret.affected_rows);
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    } catch (const std::exception& e) {
+        ret.status     = 0;
+        ret.errtype    = DB_ERR;
+        ret.errsubtype = DB_ERROR_INTERNAL;
+        ret.msg        = e.what();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+}
+
+db_reply_t update_asset_elements(tntdb::Connection& conn, const std::vector<db_asset_update_t>& updates)
+{
+    LOG_START;
+    log_debug("  count = %zu", updates.size());
+
+    db_reply_t ret = db_reply_new();
+
+    // input parameters control
+    std::set<uint32_t> ids;
+    for (const auto& update : updates) {
+        std::string error = s_check_update(update);
+        if (error.empty() && !ids.insert(update.id).second) {
+            error = "asset is updated more than once";
+        }
+        if (!error.empty()) {
+            ret.status     = 0;
+            ret.errtype    = DB_ERR;
+            ret.errsubtype = DB_ERROR_BADINPUT;
+            ret.msg        = "asset " + std::to_string(update.id) + ": " + error;
+            log_error("end: %s, %s", "ignore update", ret.msg.c_str());
+            return ret;
+        }
+    }
+
+    try {
+        fty::db::ChangeNotifier::Deferral deferral;
+        tntdb::Transaction                trans(conn);
+
+        // only assets whose fields really change are written and recorded, grouped by mask
+        auto current = s_select_current(conn, std::vector<uint32_t>(ids.begin(), ids.end()));
+        std::map<unsigned, std::vector<const db_asset_update_t*>> shapes;
+        std::vector<uint32_t>                                     changed;
+        for (const auto& update : updates) {
+            auto     it   = current.find(update.id);
+            unsigned mask = s_update_mask(update);
+            if (mask != 0 && it != current.end() && s_changes(update, it->second)) {
+                shapes[mask].push_back(&update);
+                changed.push_back(update.id);
+            }
+        }
+
+        for (const auto& shape : shapes) {
+            const auto& list     = shape.second;
+            uint64_t    affected = 0;
+            size_t      done     = 0;
+            for (size_t size : DBSql::chunks(list.size())) {
+                tntdb::Statement st = conn.prepareCached(s_update_sql(shape.first, size));
+                for (size_t i = 0; i < size; i++) {
+                    s_set_update(st, i, *list[done + i]);
+                }
+                affected += st.execute();
+                done += size;
+            }
+            ret.affected_rows += affected;
+        }
+        DBChange::record_many(conn, "t_bios_asset_element", DBChange::Op::Update, changed);
+
+        deferral.prepare();
+        trans.commit();
+        deferral.commit();
+
+        log_debug("[t_asset_element]: updated %" PRIu64 " rows", ret.affected_rows);
+        ret.status = 1;
+        LOG_END;
+        return ret;
+    } catch (const std::exception& e) {
+        ret.affected_rows = 0;
+        ret.status        = 0;
+        ret.errtype       = DB_ERR;
+        ret.errsubtype    = DB_ERROR_INTERNAL;
+        ret.msg           = e.what();
+        LOG_END_ABNORMAL(e);
+        return ret;
+    }
+}
+
 } // namespace DBAssetsUpdate
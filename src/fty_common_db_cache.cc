@@ -0,0 +1,283 @@
+/*  =========================================================================
+    fty_common_db_cache - Table-version-aware cache of query results
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_cache - Table-version-aware cache of query results
+@discuss
+@end
+*/
+
+#include "fty_common_db_cache.h"
+#include "fty_common_db_dbpath.h"
+#include "fty_common_db_notifier.h"
+#include "fty_common_db_session.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fty_log.h>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace fty::db {
+
+struct CacheEntry
+{
+    std::any                 value;
+    std::vector<std::string> tables;
+    std::vector<uint64_t>    versions;
+    bool                     refreshing = false;
+};
+
+static std::atomic<bool>                 s_enabled{false};
+static std::atomic<QueryCache::Policy>   s_dashboard_policy{QueryCache::Policy::Fresh};
+static std::atomic<uint64_t>             s_hits{0};
+static std::atomic<uint64_t>             s_misses{0};
+static std::atomic<uint64_t>             s_stale_hits{0};
+static std::mutex                        s_mutex;
+static std::map<std::string, uint64_t>   s_versions; // guarded by s_mutex
+static std::map<std::string, CacheEntry> s_entries;  // guarded by s_mutex, keyed by database identity + key
+
+// s_snapshot: current versions of tables, s_mutex must be locked
+static std::vector<uint64_t> s_snapshot(const std::vector<std::string>& tables)
+{
+    std::vector<uint64_t> versions;
+    for (const auto& table : tables) {
+        versions.push_back(s_versions[table]);
+    }
+    return versions;
+}
+
+// s_store: store loaded value, s_mutex must be locked
+static void s_store(const std::string& key, const std::vector<std::string>& tables,
+    const std::vector<uint64_t>& versions, const std::any& value)
+{
+    auto& entry      = s_entries[key];
+    entry.value      = value;
+    entry.tables     = tables;
+    entry.versions   = versions;
+    entry.refreshing = false;
+}
+
+// s_abandon: refresh of entry did not happen, the next caller loads it
+static void s_abandon(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_entries.erase(key);
+}
+
+// Refresher: the single thread reloading stale entries in background
+// destroyed (stopped) at exit before s_mutex and s_entries, which were constructed before it
+class Refresher
+{
+public:
+    struct Job
+    {
+        std::string                                 key;
+        std::string                                 identity;
+        std::vector<std::string>                    tables;
+        std::function<std::any(tntdb::Connection&)> load;
+    };
+
+    ~Refresher()
+    {
+        stop();
+    }
+
+    void push(Job&& job)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable()) {
+            m_stopping = false;
+            m_thread   = std::thread(&Refresher::run, this);
+        }
+        m_jobs.push_back(std::move(job));
+        m_cond.notify_one();
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_thread.joinable()) {
+                return;
+            }
+            m_stopping = true;
+            m_cond.notify_one();
+        }
+        m_thread.join();
+
+        std::deque<Job> jobs;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            jobs.swap(m_jobs);
+        }
+        // s_mutex is taken before m_mutex by getAny, never the other way round
+        for (const auto& job : jobs) {
+            s_abandon(job.key);
+        }
+    }
+
+private:
+    void run()
+    {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cond.wait(lock, [this]() {
+                    return m_stopping || !m_jobs.empty();
+                });
+                if (m_stopping) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            refresh(job);
+        }
+    }
+
+    static void refresh(const Job& job)
+    {
+        try {
+            tntdb::Connection conn = tntdb::connectCached(DBConn::url);
+            if (DBSession::identity(conn) != job.identity) {
+                // the entry belongs to a database this process has no url for
+                s_abandon(job.key);
+                return;
+            }
+
+            std::vector<uint64_t> versions;
+            {
+                std::lock_guard<std::mutex> lock(s_mutex);
+                versions = s_snapshot(job.tables);
+            }
+            std::any value = job.load(conn);
+
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_store(job.key, job.tables, versions, value);
+        } catch (const std::exception& e) {
+            log_error("background refresh of cached query failed: %s", e.what());
+            s_abandon(job.key);
+        }
+    }
+
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Job>         m_jobs;     // guarded by m_mutex
+    bool                    m_stopping = false;
+    std::thread             m_thread;
+};
+
+static Refresher& s_refresher()
+{
+    static Refresher refresher;
+    return refresher;
+}
+
+void QueryCache::enable(bool enabled)
+{
+    log_debug("query cache %s", enabled ? "enabled" : "disabled");
+    s_enabled = enabled;
+    if (!enabled) {
+        s_refresher().stop();
+        clear();
+    }
+}
+
+bool QueryCache::enabled()
+{
+    return s_enabled;
+}
+
+QueryCache::Stats QueryCache::stats()
+{
+    return {s_hits, s_misses, s_stale_hits};
+}
+
+void QueryCache::clear()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_entries.clear();
+}
+
+void QueryCache::bump(const std::string& table)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_versions[table]++;
+}
+
+void QueryCache::setDashboardPolicy(Policy policy)
+{
+    s_dashboard_policy = policy;
+}
+
+QueryCache::Policy QueryCache::dashboardPolicy()
+{
+    return s_dashboard_policy;
+}
+
+std::any QueryCache::getAny(tntdb::Connection& conn, const std::string& key, const std::vector<std::string>& tables,
+    const Loader& load, Policy policy)
+{
+    // a transaction must see its own writes, and its reads may not be committed (or current) ones
+    // it is known by its Deferral, the identity of conn is queried once per connection
+    if (ChangeNotifier::deferring()) {
+        return load(conn);
+    }
+    std::string identity = DBSession::identity(conn);
+    std::string full     = identity + '\x1e' + key;
+
+    std::vector<uint64_t> versions;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        versions = s_snapshot(tables);
+
+        auto it = s_entries.find(full);
+        if (it != s_entries.end()) {
+            auto& entry = it->second;
+            if (entry.tables == tables && entry.versions == versions) {
+                s_hits++;
+                return entry.value;
+            }
+            if (policy == Policy::StaleWhileRevalidate) {
+                s_stale_hits++;
+                if (!entry.refreshing) {
+                    entry.refreshing = true;
+                    s_refresher().push({full, identity, tables, load});
+                }
+                return entry.value;
+            }
+        }
+    }
+
+    // versions are taken before loading, a write committed meanwhile makes the entry stale
+    s_misses++;
+    std::any value = load(conn);
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_store(full, tables, versions, value);
+    return value;
+}
+
+} // namespace fty::db
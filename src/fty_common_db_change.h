@@ -0,0 +1,61 @@
+/*  =========================================================================
+    fty_common_db_change - Recording of changes done by write functions
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_common_db_notifier.h"
+#include <cstdint>
+#include <string>
+#include <tntdb/connect.h>
+#include <vector>
+
+namespace DBChange {
+
+using Op = fty::db::ChangeEvent::Operation;
+
+// op_to_string: "insert", "update" or "delete"
+const char* op_to_string(Op op);
+
+// record: note a change done by a write function of this library
+// invalidates cached queries reading table, refreshes the configured state of asset_id if it depends on table (when
+// enabled) and notifies observers of fty::db::ChangeNotifier, now or at commit of the active Deferral
+// if the change journal is enabled, an entry for asset_id is written now or in one batch with the other changes of the
+// active Deferral when it is prepared; no round trip is added otherwise
+// call it after conn.lastInsertId() was read, journaling resets it
+// does nothing if affected_rows is 0, asset_id 0 means the change is not bound to an asset (cache only)
+// failure of the journal is only logged, except deadlock and lock wait timeout, which are rethrown as MySQL rolled
+// back the transaction (or the statement) of the caller
+void record(tntdb::Connection& conn, const std::string& table, Op op, uint32_t asset_id, uint64_t affected_rows);
+
+// record: same as above for asset identified by internal name
+void record(
+    tntdb::Connection& conn, const std::string& table, Op op, const std::string& asset_name, uint64_t affected_rows);
+
+// record_many: same as record for each of asset_ids (one affected row each, ids 0 and repeated ids are skipped)
+// invalidates the cache once, journals up to 256 assets per statement (when enabled) and refreshes their configured
+// state with set-based statements, for write functions changing many assets at once
+void record_many(tntdb::Connection& conn, const std::string& table, Op op, const std::vector<uint32_t>& asset_ids);
+
+// journal: write changes to the change journal if it is enabled, grouped by table and operation
+// used by ChangeNotifier to write the changes queued in a Deferral; failures are handled as by record
+void journal(tntdb::Connection& conn, const std::vector<fty::db::ChangeEvent>& events);
+
+} // namespace DBChange
@@ -0,0 +1,46 @@
+/*  =========================================================================
+    fty_common_db_configured - Maintenance of the configured table
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <tntdb/connect.h>
+#include <vector>
+
+namespace DBConfigured {
+
+// condition: SQL condition matching configured (yes) or not configured (!yes) assets
+// over v_bios_asset_element_super_parent aliased as v, implemented with the filters
+std::string condition(bool yes);
+
+// enabled: true if the configured table is maintained and used
+bool enabled();
+
+// refresh: recompute the state of asset and of its direct children (sensors depend on the parent of their parent)
+// retried once after lock wait timeout; if it fails, the state dropped by the triggers is computed at query time
+// throws on deadlock only, as MySQL rolled back the transaction of the caller
+void refresh(tntdb::Connection& conn, uint32_t asset_id);
+
+// refresh_many: same as refresh for many assets, with two set-based statements per 256 assets (ids 0 are ignored)
+void refresh_many(tntdb::Connection& conn, const std::vector<uint32_t>& asset_ids);
+
+} // namespace DBConfigured
@@ -1,5 +1,6 @@
 #include "fty_common_db_connection.h"
 #include "fty_common_db_dbpath.h"
+#include "fty_common_db_notifier.h"
 #include <tntdb.h>
 
 // =====================================================================================================================
@@ -66,7 +67,9 @@ struct fty::db::Transaction::Impl
     {
     }
 
-    tntdb::Transaction m_trans;
+    // constructed before the transaction begins and destroyed after it ended
+    fty::db::ChangeNotifier::Deferral m_deferral;
+    tntdb::Transaction                m_trans;
 };
 
 // =====================================================================================================================
@@ -479,18 +482,26 @@ fty::db::Transaction::Transaction(Connection& con)
 {
 }
 
+fty::db::Transaction::Transaction(tntdb::Connection& con)
+    : m_impl(std::make_unique<Impl>(con))
+{
+}
+
 fty::db::Transaction::~Transaction()
 {
 }
 
 void fty::db::Transaction::commit()
 {
+    m_impl->m_deferral.prepare();
     m_impl->m_trans.commit();
+    m_impl->m_deferral.commit();
 }
 
 void fty::db::Transaction::rollback()
 {
     m_impl->m_trans.rollback();
+    m_impl->m_deferral.discard();
 }
 
 // =====================================================================================================================
@@ -0,0 +1,219 @@
+/*  =========================================================================
+    fty_common_db_notifier - In-process notifications of asset changes
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_notifier - In-process notifications of asset changes
+@discuss
+@end
+*/
+
+#include "fty_common_db_notifier.h"
+#include "fty_common_db_cache.h"
+#include "fty_common_db_change.h"
+#include <czmq.h>
+#include <fty_log.h>
+#include <map>
+#include <mutex>
+
+namespace fty::db {
+
+static std::mutex                                   s_observers_mutex;
+static std::map<uint64_t, ChangeNotifier::Observer> s_observers; // guarded by s_observers_mutex
+static uint64_t                                     s_next_handle = 1;
+static std::mutex                                   s_publisher_mutex;
+static zsock_t*                                     s_publisher = nullptr; // guarded by s_publisher_mutex
+static thread_local ChangeNotifier::Deferral*       s_current_deferral = nullptr;
+
+uint64_t ChangeNotifier::subscribe(const Observer& observer)
+{
+    std::lock_guard<std::mutex> lock(s_observers_mutex);
+    uint64_t                    handle = s_next_handle++;
+    s_observers.emplace(handle, observer);
+    return handle;
+}
+
+void ChangeNotifier::unsubscribe(uint64_t handle)
+{
+    std::lock_guard<std::mutex> lock(s_observers_mutex);
+    s_observers.erase(handle);
+}
+
+int ChangeNotifier::startPublisher(const std::string& endpoint)
+{
+    std::lock_guard<std::mutex> lock(s_publisher_mutex);
+    if (s_publisher) {
+        log_error("change publisher is already started");
+        return -1;
+    }
+    s_publisher = zsock_new_pub(endpoint.c_str());
+    if (!s_publisher) {
+        log_error("cannot bind change publisher to %s", endpoint.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+void ChangeNotifier::stopPublisher()
+{
+    std::lock_guard<std::mutex> lock(s_publisher_mutex);
+    zsock_destroy(&s_publisher);
+}
+
+const char* ChangeNotifier::operationToString(ChangeEvent::Operation operation)
+{
+    switch (operation) {
+        case ChangeEvent::Operation::Insert:
+            return "insert";
+        case ChangeEvent::Operation::Update:
+            return "update";
+        case ChangeEvent::Operation::Delete:
+            return "delete";
+    }
+    return "";
+}
+
+void ChangeNotifier::notify(const ChangeEvent& event)
+{
+    if (s_current_deferral) {
+        s_current_deferral->m_events.push_back(event);
+        return;
+    }
+    deliver(event);
+}
+
+void ChangeNotifier::invalidate(const std::string& table)
+{
+    if (s_current_deferral) {
+        s_current_deferral->m_tables.insert(table);
+        return;
+    }
+    QueryCache::bump(table);
+}
+
+bool ChangeNotifier::deferring()
+{
+    return s_current_deferral != nullptr;
+}
+
+void ChangeNotifier::journal(tntdb::Connection& conn, const ChangeEvent& event)
+{
+    if (s_current_deferral) {
+        s_current_deferral->m_journal.emplace_back(conn, event);
+        return;
+    }
+    DBChange::journal(conn, {event});
+}
+
+void ChangeNotifier::deliver(const ChangeEvent& event)
+{
+    std::vector<Observer> observers;
+    {
+        // observers are called without the lock, so they can (un)subscribe
+        std::lock_guard<std::mutex> lock(s_observers_mutex);
+        for (const auto& it : s_observers) {
+            observers.push_back(it.second);
+        }
+    }
+    for (const auto& observer : observers) {
+        try {
+            observer(event);
+        } catch (const std::exception& e) {
+            log_error("change observer failed: %s", e.what());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(s_publisher_mutex);
+    if (s_publisher) {
+        zstr_sendx(s_publisher, event.table.c_str(), operationToString(event.operation),
+            std::to_string(event.assetId).c_str(), event.assetName.c_str(), nullptr);
+    }
+}
+
+ChangeNotifier::Deferral::Deferral()
+    : m_previous(s_current_deferral)
+{
+    s_current_deferral = this;
+}
+
+ChangeNotifier::Deferral::~Deferral()
+{
+    discard();
+    s_current_deferral = m_previous;
+}
+
+void ChangeNotifier::Deferral::prepare()
+{
+    std::vector<JournalEntry> journal;
+    journal.swap(m_journal);
+
+    // one batch per connection, in order of the changes
+    while (!journal.empty()) {
+        tntdb::Connection        conn = journal.front().first;
+        std::vector<ChangeEvent> events;
+        auto                     it = journal.begin();
+        for (; it != journal.end() && it->first.getImpl() == conn.getImpl(); ++it) {
+            events.push_back(it->second);
+        }
+        journal.erase(journal.begin(), it);
+        DBChange::journal(conn, events);
+    }
+}
+
+void ChangeNotifier::Deferral::commit()
+{
+    std::vector<ChangeEvent> events;
+    std::set<std::string>    tables;
+    events.swap(m_events);
+    tables.swap(m_tables);
+
+    if (m_previous) {
+        m_previous->m_events.insert(m_previous->m_events.end(), events.begin(), events.end());
+        m_previous->m_tables.insert(tables.begin(), tables.end());
+        m_previous->m_journal.insert(m_previous->m_journal.end(), m_journal.begin(), m_journal.end());
+        m_journal.clear();
+        return;
+    }
+    try {
+        prepare();
+    } catch (const std::exception& e) {
+        log_error("changes were not journaled: %s", e.what());
+    }
+    for (const auto& table : tables) {
+        QueryCache::bump(table);
+    }
+    // writes done by observers are not part of this deferral anymore
+    Deferral* current  = s_current_deferral;
+    s_current_deferral = nullptr;
+    for (const auto& event : events) {
+        deliver(event);
+    }
+    s_current_deferral = current;
+}
+
+void ChangeNotifier::Deferral::discard()
+{
+    m_events.clear();
+    m_tables.clear();
+    m_journal.clear();
+}
+
+} // namespace fty::db
@@ -0,0 +1,469 @@
+/*  =========================================================================
+    fty_common_db_purge - Throttled background purge of assets
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_purge - Throttled background purge of assets
+@discuss
+@end
+*/
+
+#include "fty_common_db_purge.h"
+#include "fty_common_db_change.h"
+#include "fty_common_db_dbpath.h"
+#include "fty_common_db_session.h"
+#include "fty_common_db_sql.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fty_log.h>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tntdb/error.h>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+namespace fty::db {
+
+// assets taken from the queue by one step
+static constexpr size_t PURGE_BATCH = 64;
+
+struct Stage
+{
+    const char*  table; // for change notification
+    DBChange::Op op;
+    const char*  sql;      // with %IDS% for the IN list and :limit
+    const char*  affected; // with %IDS%, assets whose change is recorded, nullptr to tell cache and observers only
+};
+
+// stages of each scope, in dependency order
+// elements are deleted separately, as one of them may fail
+static const std::vector<Stage> s_ext_stages = {
+    {"t_bios_asset_ext_attributes", DBChange::Op::Delete,
+        " DELETE FROM t_bios_asset_ext_attributes WHERE id_asset_element IN (%IDS%) LIMIT :limit", nullptr},
+};
+static const std::vector<Stage> s_link_stages = {
+    {"t_bios_asset_link", DBChange::Op::Delete,
+        " DELETE FROM t_bios_asset_link"
+        " WHERE id_asset_device_src IN (%IDS%) OR id_asset_device_dest IN (%IDS%) LIMIT :limit",
+        " SELECT id_asset_device_dest FROM t_bios_asset_link"
+        " WHERE id_asset_device_src IN (%IDS%) OR id_asset_device_dest IN (%IDS%)"},
+};
+static const std::vector<Stage> s_asset_stages = {
+    s_ext_stages[0],
+    s_link_stages[0],
+    {"t_bios_asset_group_relation", DBChange::Op::Delete,
+        " DELETE FROM t_bios_asset_group_relation"
+        " WHERE id_asset_element IN (%IDS%) OR id_asset_group IN (%IDS%) LIMIT :limit", nullptr},
+    {"t_bios_monitor_asset_relation", DBChange::Op::Delete,
+        " DELETE FROM t_bios_monitor_asset_relation WHERE id_asset_element IN (%IDS%) LIMIT :limit", nullptr},
+    {"t_bios_asset_element", DBChange::Op::Update,
+        " UPDATE t_bios_asset_element SET id_parent = NULL WHERE id_parent IN (%IDS%) LIMIT :limit",
+        " SELECT id_asset_element FROM t_bios_asset_element WHERE id_parent IN (%IDS%)"},
+};
+
+static std::atomic<bool>     s_running{false};
+static std::atomic<uint64_t> s_deleted_rows{0};
+static std::atomic<uint64_t> s_chunks{0};
+static std::atomic<uint64_t> s_purged_assets{0};
+static std::atomic<uint64_t> s_failed_assets{0};
+static std::atomic<uint64_t> s_lock_timeouts{0};
+static std::atomic<uint64_t> s_last_chunk_usec{0};
+static std::atomic<uint64_t> s_max_chunk_usec{0};
+
+static std::mutex              s_mutex;
+static std::condition_variable s_cond;
+static bool                    s_stopping = false; // guarded by s_mutex
+
+// the queue table is created by database/mysql/0001_asset_purge_queue.sql, the thread waits longer without it
+static std::atomic<bool> s_queue_missing{false};
+
+static const char* s_scope_to_string(Purge::Scope scope)
+{
+    switch (scope) {
+        case Purge::Scope::ExtAttributes:
+            return "ext_attributes";
+        case Purge::Scope::Links:
+            return "links";
+        case Purge::Scope::Asset:
+            return "asset";
+    }
+    return "asset";
+}
+
+// s_failed: log error of a statement on the queue
+static void s_failed(const char* what, const std::exception& e)
+{
+    if (DBSession::missing_table(e)) {
+        s_queue_missing = true;
+        log_error("%s failed, t_bios_asset_purge_queue is missing (schema migration not applied): %s", what, e.what());
+        return;
+    }
+    log_error("%s failed: %s", what, e.what());
+}
+
+// s_select: ids selected by statement over ids (at most PURGE_BATCH of them)
+static std::vector<uint32_t> s_select(tntdb::Connection& conn, const std::string& sql, const std::vector<uint32_t>& ids)
+{
+    size_t bucket = DBSql::chunk_bucket(ids.size());
+
+    tntdb::Statement st = conn.prepareCached(DBSql::in_sql(sql, bucket));
+    for (size_t i = 0; i < bucket; i++) {
+        st.set(DBSql::placeholder("id", i), ids[std::min(i, ids.size() - 1)]);
+    }
+    std::set<uint32_t> found;
+    for (const auto& row : st.select()) {
+        uint32_t id = 0;
+        row[0].get(id);
+        found.insert(id);
+    }
+    return std::vector<uint32_t>(found.begin(), found.end());
+}
+
+// s_execute: execute statement over ids (at most PURGE_BATCH of them), measure it
+static uint64_t s_execute(tntdb::Connection& conn, const std::string& sql, const std::vector<uint32_t>& ids,
+    uint32_t limit)
+{
+    size_t bucket = DBSql::chunk_bucket(ids.size());
+
+    tntdb::Statement st = conn.prepareCached(DBSql::in_sql(sql, bucket));
+    for (size_t i = 0; i < bucket; i++) {
+        st.set(DBSql::placeholder("id", i), ids[std::min(i, ids.size() - 1)]);
+    }
+    if (sql.find(":limit") != std::string::npos) {
+        st.set("limit", limit);
+    }
+
+    auto     start = std::chrono::steady_clock::now();
+    uint64_t n     = st.execute();
+    uint64_t usec  = uint64_t(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
+    s_last_chunk_usec = usec;
+    if (usec > s_max_chunk_usec) {
+        s_max_chunk_usec = usec;
+    }
+    if (n > 0) {
+        s_chunks++;
+    }
+    return n;
+}
+
+// s_delete_elements: delete purged elements, one by one if some of them cannot be deleted
+// returns ids of elements which cannot be deleted
+static std::vector<uint32_t> s_delete_elements(tntdb::Connection& conn, const std::vector<uint32_t>& ids)
+{
+    static const std::string sql = " DELETE FROM t_bios_asset_element WHERE id_asset_element IN (%IDS%)";
+    try {
+        s_deleted_rows += s_execute(conn, sql, ids, 0);
+        DBChange::record_many(conn, "t_bios_asset_element", DBChange::Op::Delete, ids);
+        return {};
+    } catch (const tntdb::Error& e) {
+        if (DBSession::deadlock(e) || DBSession::lock_wait_timeout(e)) {
+            throw;
+        }
+        log_debug("purged elements cannot be deleted at once: %s", e.what());
+    }
+    std::vector<uint32_t> failed;
+    for (uint32_t id : ids) {
+        try {
+            s_deleted_rows += s_execute(conn, sql, {id}, 0);
+            DBChange::record(conn, "t_bios_asset_element", DBChange::Op::Delete, id, 1);
+        } catch (const tntdb::Error& e) {
+            if (DBSession::deadlock(e) || DBSession::lock_wait_timeout(e)) {
+                throw;
+            }
+            log_error("purged asset %" PRIu32 " cannot be deleted, kept in the queue as failed: %s", id, e.what());
+            failed.push_back(id);
+        }
+    }
+    return failed;
+}
+
+// s_dequeue: remove ids of scope from the queue, or mark them failed (they are skipped until queued again)
+static void s_dequeue(tntdb::Connection& conn, const std::string& scope, const std::vector<uint32_t>& ids, bool failed)
+{
+    size_t           bucket = DBSql::chunk_bucket(ids.size());
+    tntdb::Statement st     = conn.prepareCached(DBSql::in_sql(
+        failed ? " UPDATE t_bios_asset_purge_queue SET failed = 1 WHERE scope = :scope AND id_asset_element IN (%IDS%)"
+                   : " DELETE FROM t_bios_asset_purge_queue WHERE scope = :scope AND id_asset_element IN (%IDS%)",
+        bucket));
+    st.set("scope", scope);
+    for (size_t i = 0; i < bucket; i++) {
+        st.set(DBSql::placeholder("id", i), ids[std::min(i, ids.size() - 1)]);
+    }
+    st.execute();
+}
+
+int Purge::enqueue(tntdb::Connection& conn, const std::vector<uint32_t>& ids, Scope scope)
+{
+    LOG_START;
+    try {
+        size_t done = 0;
+        for (size_t size : DBSql::chunks(ids.size())) {
+            // failed assets are retried when queued again
+            tntdb::Statement st = conn.prepareCached(
+                DBSql::multi_insert("INSERT INTO t_bios_asset_purge_queue (id_asset_element, scope) ", 2, size,
+                    " ON DUPLICATE KEY UPDATE failed = 0"));
+            for (size_t i = 0; i < size; i++) {
+                st.set(DBSql::multi_placeholder(i, 0), ids[done + i]);
+                st.set(DBSql::multi_placeholder(i, 1), s_scope_to_string(scope));
+            }
+            st.execute();
+            done += size;
+        }
+        s_queue_missing = false;
+        s_cond.notify_all();
+        LOG_END;
+        return 0;
+    } catch (const std::exception& e) {
+        s_failed("enqueue", e);
+        LOG_END_ABNORMAL(e);
+        return -1;
+    }
+}
+
+// s_count: number of queued assets, failed or not
+static int64_t s_count(tntdb::Connection& conn, bool failed)
+{
+    try {
+        uint64_t count = 0;
+        conn.prepareCached(" SELECT COUNT(*) FROM t_bios_asset_purge_queue WHERE failed = :failed")
+            .set("failed", failed)
+            .selectValue()
+            .get(count);
+        return int64_t(count);
+    } catch (const std::exception& e) {
+        s_failed("reading of purge queue", e);
+        return -1;
+    }
+}
+
+int64_t Purge::pending(tntdb::Connection& conn)
+{
+    return s_count(conn, false);
+}
+
+int64_t Purge::failed(tntdb::Connection& conn)
+{
+    return s_count(conn, true);
+}
+
+int64_t Purge::step(tntdb::Connection& conn, uint32_t maxRows)
+{
+    maxRows = std::max(maxRows, 1u);
+    try {
+        // oldest scope first, then a batch of assets with that scope
+        tntdb::Result head = conn.prepareCached(
+                                     " SELECT scope FROM t_bios_asset_purge_queue WHERE failed = 0"
+                                     " ORDER BY enqueued_at, id_asset_element LIMIT 1")
+                                 .select();
+        if (head.empty()) {
+            return 0;
+        }
+        std::string scope;
+        head.getRow(0)[0].get(scope);
+
+        std::vector<uint32_t> ids;
+        for (const auto& row : conn.prepareCached(
+                                       " SELECT id_asset_element FROM t_bios_asset_purge_queue"
+                                       " WHERE scope = :scope AND failed = 0 ORDER BY id_asset_element LIMIT :batch")
+                                   .set("scope", scope)
+                                   .set("batch", uint32_t(PURGE_BATCH))
+                                   .select()) {
+            uint32_t id = 0;
+            row[0].get(id);
+            ids.push_back(id);
+        }
+        if (ids.empty()) {
+            return 0;
+        }
+
+        // finished stages delete nothing and cost one index lookup
+        const auto& stages =
+            scope == "ext_attributes" ? s_ext_stages : (scope == "links" ? s_link_stages : s_asset_stages);
+        uint64_t total = 0;
+        for (const auto& stage : stages) {
+            // assets changed by the whole stage, the chunk may change only some of them, the rest is recorded again
+            // by the next chunks
+            std::vector<uint32_t> affected;
+            if (stage.affected) {
+                affected = s_select(conn, stage.affected, ids);
+            }
+            uint32_t limit = maxRows - uint32_t(total);
+            uint64_t n     = s_execute(conn, stage.sql, ids, limit);
+            if (!stage.affected) {
+                DBChange::record(conn, stage.table, stage.op, 0, n);
+            } else if (n > 0) {
+                DBChange::record_many(conn, stage.table, stage.op, affected);
+            }
+            total += n;
+            if (n == limit) {
+                // budget used up, maybe more rows are left in this stage
+                s_deleted_rows += total;
+                return int64_t(total);
+            }
+        }
+        std::vector<uint32_t> failed;
+        if (scope == "asset") {
+            failed = s_delete_elements(conn, ids);
+        }
+        if (!failed.empty()) {
+            s_dequeue(conn, scope, failed, true);
+            s_failed_assets += failed.size();
+            std::vector<uint32_t> purged;
+            std::set_difference(
+                ids.begin(), ids.end(), failed.begin(), failed.end(), std::back_inserter(purged));
+            ids = std::move(purged);
+        }
+        if (!ids.empty()) {
+            s_dequeue(conn, scope, ids, false);
+        }
+        s_purged_assets += ids.size();
+        s_deleted_rows += total;
+        // an empty step would look like an empty queue
+        return int64_t(std::max(total, uint64_t(1)));
+    } catch (const std::exception& e) {
+        if (DBSession::deadlock(e) || DBSession::lock_wait_timeout(e)) {
+            s_lock_timeouts++;
+        }
+        s_failed("purge step", e);
+        return -1;
+    }
+}
+
+static void s_run(Purge::Options options)
+{
+    auto s_wait = [](std::chrono::microseconds delay) {
+        std::unique_lock<std::mutex> lock(s_mutex);
+        return !s_cond.wait_for(lock, delay, []() {
+            return s_stopping;
+        });
+    };
+
+    tntdb::Connection conn;
+    bool              connected = false;
+    while (true) {
+        int64_t n = -1;
+        try {
+            if (!connected) {
+                conn = tntdb::connect(DBConn::url);
+                // purge gives up quickly instead of waiting for locks held by others
+                conn.prepare(" SET SESSION innodb_lock_wait_timeout = :timeout")
+                    .set("timeout", options.lockWaitTimeoutSec)
+                    .execute();
+                connected = true;
+            }
+            n = Purge::step(conn, options.chunkRows);
+        } catch (const std::exception& e) {
+            log_error("purge connection failed: %s", e.what());
+            connected = false;
+        }
+
+        std::chrono::microseconds delay;
+        if (n < 0) {
+            delay = s_queue_missing ? std::chrono::seconds(60) : std::chrono::seconds(1);
+        } else if (n == 0) {
+            delay = std::chrono::seconds(5);
+        } else {
+            // stay within the budget, always yield to others between chunks
+            delay = std::max(std::chrono::microseconds(uint64_t(n) * 1000000 / std::max(options.rowsPerSecond, 1u)),
+                std::chrono::microseconds(1000));
+        }
+        if (!s_wait(delay)) {
+            return;
+        }
+    }
+}
+
+void Purge::start()
+{
+    start(Options());
+}
+
+// Runner: the background thread of the purge
+// destroyed (stopped) at exit before s_mutex and s_cond, which were constructed before it
+class Runner
+{
+public:
+    ~Runner()
+    {
+        stop();
+    }
+
+    void start(const Purge::Options& options)
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_stopping = false;
+        }
+        s_running = true;
+        m_thread  = std::thread(s_run, options);
+    }
+
+    void stop()
+    {
+        if (!m_thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_stopping = true;
+        }
+        s_cond.notify_all();
+        m_thread.join();
+        s_running = false;
+        log_debug("purge stopped");
+    }
+
+private:
+    std::thread m_thread;
+};
+
+static Runner& s_runner()
+{
+    static Runner runner;
+    return runner;
+}
+
+void Purge::start(const Options& options)
+{
+    stop();
+    log_debug("purge started (%" PRIu32 " rows per chunk, %" PRIu32 " rows per second)", options.chunkRows,
+        options.rowsPerSecond);
+    s_runner().start(options);
+}
+
+void Purge::stop()
+{
+    s_runner().stop();
+}
+
+Purge::Progress Purge::progress()
+{
+    return {s_running, s_deleted_rows, s_chunks, s_purged_assets, s_failed_assets, s_lock_timeouts, s_last_chunk_usec,
+        s_max_chunk_usec};
+}
+
+} // namespace fty::db
@@ -0,0 +1,123 @@
+/*  =========================================================================
+    fty_common_db_session - Private helpers describing the session of a connection
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_session - Private helpers describing the session of a connection
+@discuss
+@end
+*/
+
+#include "fty_common_db_session.h"
+#include "fty_common_db_dbpath.h"
+#include <fty_log.h>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+namespace DBSession {
+
+// identities of connections by their implementation, which lives as long as the connection (or its pool)
+// a freed implementation may be reused by a new connection, to the same database in practice; the map is only
+// cleared when it grows too much
+static constexpr size_t MAX_IDENTITIES = 256;
+
+static std::mutex                         s_identities_mutex;
+static std::map<const void*, std::string> s_identities; // guarded by s_identities_mutex
+
+State state(tntdb::Connection& conn)
+{
+    tntdb::Row row = conn.prepareCached(" SELECT @@hostname, @@port, COALESCE(DATABASE(), '')").selectRow();
+
+    std::string host;
+    unsigned    port = 0;
+    State       ret;
+    row[0].get(host);
+    row[1].get(port);
+    row[2].get(ret.schema);
+    ret.server = host + ":" + std::to_string(port);
+    return ret;
+}
+
+std::string identity(tntdb::Connection& conn)
+{
+    const void* impl = conn.getImpl();
+    {
+        std::lock_guard<std::mutex> lock(s_identities_mutex);
+        auto                        it = s_identities.find(impl);
+        if (it != s_identities.end()) {
+            return it->second;
+        }
+    }
+    std::string ret = state(conn).identity();
+
+    std::lock_guard<std::mutex> lock(s_identities_mutex);
+    if (s_identities.size() >= MAX_IDENTITIES) {
+        s_identities.clear();
+    }
+    s_identities[impl] = ret;
+    return ret;
+}
+
+tntdb::Connection connect(tntdb::Connection& conn, bool cached)
+{
+    State wanted = state(conn);
+
+    tntdb::Connection ret = cached ? tntdb::connectCached(DBConn::url) : tntdb::connect(DBConn::url);
+    State             got = state(ret);
+    if (got.server != wanted.server) {
+        throw std::runtime_error("database url points to " + got.server + ", not to " + wanted.server);
+    }
+    if (got.schema == wanted.schema || wanted.schema.empty()) {
+        return ret;
+    }
+    if (cached) {
+        // never change the default database of a pooled connection
+        return connect(conn, false);
+    }
+    log_debug("switching new connection from database '%s' to '%s'", got.schema.c_str(), wanted.schema.c_str());
+    ret.execute("USE `" + wanted.schema + "`");
+    std::lock_guard<std::mutex> lock(s_identities_mutex);
+    s_identities.erase(ret.getImpl());
+    return ret;
+}
+
+// error messages of the server (ER_LOCK_DEADLOCK, ER_LOCK_WAIT_TIMEOUT and ER_NO_SUCH_TABLE), tntdb does not expose
+// error codes
+bool deadlock(const std::exception& e)
+{
+    return std::string(e.what()).find("Deadlock found when trying to get lock") != std::string::npos;
+}
+
+bool lock_wait_timeout(const std::exception& e)
+{
+    return std::string(e.what()).find("Lock wait timeout exceeded") != std::string::npos;
+}
+
+bool missing_table(const std::exception& e)
+{
+    std::string what = e.what();
+    return what.find("Table '") != std::string::npos && what.find("' doesn't exist") != std::string::npos;
+}
+
+} // namespace DBSession
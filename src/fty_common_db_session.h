@@ -0,0 +1,64 @@
+/*  =========================================================================
+    fty_common_db_session - Private helpers describing the session of a connection
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <exception>
+#include <string>
+#include <tntdb/connect.h>
+
+namespace DBSession {
+
+struct State
+{
+    std::string server; // "host:port" of the database server
+    std::string schema; // default database of the connection
+
+    // identity: "host:port/schema", part of keys of results shared between connections
+    std::string identity() const
+    {
+        return server + "/" + schema;
+    }
+};
+
+// state: state of the session of conn, one round trip
+State state(tntdb::Connection& conn);
+
+// identity: state(conn).identity(), queried once per connection (its server and default database must not change)
+std::string identity(tntdb::Connection& conn);
+
+// connect: new connection to the database of conn, for DDL (which commits implicitly) and for work which must not
+// be part of the transaction of the caller
+// a cached connection is returned only if DBConn::url has the same default database, otherwise the new connection
+// is switched to it by USE
+// throws if DBConn::url points to another server
+tntdb::Connection connect(tntdb::Connection& conn, bool cached = false);
+
+// deadlock: MySQL rolled back the whole transaction of the session
+bool deadlock(const std::exception& e);
+
+// lock_wait_timeout: MySQL rolled back the statement which waited for a lock
+bool lock_wait_timeout(const std::exception& e);
+
+// missing_table: a table used by the statement does not exist (its schema migration was not applied)
+bool missing_table(const std::exception& e);
+
+} // namespace DBSession
@@ -0,0 +1,119 @@
+/*  =========================================================================
+    fty_common_db_singleflight - Deduplication of identical concurrent queries
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_singleflight - Deduplication of identical concurrent queries
+@discuss
+@end
+*/
+
+#include "fty_common_db_singleflight.h"
+#include "fty_common_db_notifier.h"
+#include "fty_common_db_session.h"
+#include <atomic>
+#include <fty_log.h>
+
+namespace fty::db {
+
+static std::atomic<bool>     s_enabled{false};
+static std::atomic<uint64_t> s_executed{0};
+static std::atomic<uint64_t> s_coalesced{0};
+
+static std::mutex s_calls_mutex;
+
+// calls in flight, guarded by s_calls_mutex
+std::map<std::string, std::shared_ptr<SingleFlight::Call>>& SingleFlight::calls()
+{
+    static std::map<std::string, std::shared_ptr<Call>> calls;
+    return calls;
+}
+
+// key prefix of calls on conn, empty if the call must not be shared
+// no round trip once the identity of conn is known, the transaction is known by its Deferral
+std::string SingleFlight::scope(tntdb::Connection& conn)
+{
+    return ChangeNotifier::deferring() ? std::string() : DBSession::identity(conn);
+}
+
+void SingleFlight::enable(bool enabled)
+{
+    log_debug("single-flight queries %s", enabled ? "enabled" : "disabled");
+    s_enabled = enabled;
+}
+
+bool SingleFlight::enabled()
+{
+    return s_enabled;
+}
+
+SingleFlight::Stats SingleFlight::stats()
+{
+    return {s_executed, s_coalesced};
+}
+
+void SingleFlight::resetStats()
+{
+    s_executed  = 0;
+    s_coalesced = 0;
+}
+
+std::shared_ptr<SingleFlight::Call> SingleFlight::join(const std::string& key, bool& leader)
+{
+    std::lock_guard<std::mutex> lock(s_calls_mutex);
+
+    auto it = calls().find(key);
+    if (it != calls().end()) {
+        leader = false;
+        s_coalesced++;
+        return it->second;
+    }
+
+    leader    = true;
+    auto call = std::make_shared<Call>();
+    calls().emplace(key, call);
+    s_executed++;
+    return call;
+}
+
+void SingleFlight::finish(const std::string& key, const std::shared_ptr<Call>& call)
+{
+    {
+        // late callers start a new query from now on
+        std::lock_guard<std::mutex> lock(s_calls_mutex);
+        calls().erase(key);
+    }
+    {
+        std::lock_guard<std::mutex> lock(call->mutex);
+        call->done = true;
+    }
+    call->cond.notify_all();
+}
+
+void SingleFlight::wait(const std::shared_ptr<Call>& call)
+{
+    std::unique_lock<std::mutex> lock(call->mutex);
+    call->cond.wait(lock, [&call]() {
+        return call->done;
+    });
+}
+
+} // namespace fty::db
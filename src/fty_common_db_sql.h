@@ -0,0 +1,144 @@
+/*  =========================================================================
+    fty_common_db_sql - Private helpers for building SQL statements
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <fty_common_asset_types.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace DBSql {
+
+// maximal number of values bound into one IN (...) list or multi-row statement
+static constexpr size_t CHUNK_SIZE = 256;
+
+// chunk_bucket: round size of a list up to the next power of two (max CHUNK_SIZE)
+// lists are padded to the bucket size so only a few statement shapes are prepared (and cached)
+inline size_t chunk_bucket(size_t count)
+{
+    size_t bucket = 1;
+    while (bucket < count && bucket < CHUNK_SIZE) {
+        bucket *= 2;
+    }
+    return bucket;
+}
+
+// placeholder: generate the placeholder name
+// example: placeholder("id", 3) -> "id3"
+inline std::string placeholder(const std::string& prefix, size_t i)
+{
+    return prefix + std::to_string(i);
+}
+
+// in_list: generate list of placeholders for IN (...) clause
+// example: in_list("id", 3) -> ":id0, :id1, :id2"
+inline std::string in_list(const std::string& prefix, size_t count)
+{
+    std::string out;
+    for (size_t i = 0; i < count; i++) {
+        out += (i > 0 ? ", :" : ":") + placeholder(prefix, i);
+    }
+    return out;
+}
+
+// in_sql: replace every "%IDS%" in sql by in_list("id", bucket)
+// example: in_sql("a IN (%IDS%) OR b IN (%IDS%)", 2) -> "a IN (:id0, :id1) OR b IN (:id0, :id1)"
+inline std::string in_sql(const std::string& sql, size_t bucket)
+{
+    std::string out  = sql;
+    std::string list = in_list("id", bucket);
+    for (size_t pos = out.find("%IDS%"); pos != std::string::npos; pos = out.find("%IDS%", pos + list.size())) {
+        out.replace(pos, 5, list);
+    }
+    return out;
+}
+
+// chunks: split count rows into statements of CHUNK_SIZE rows and power-of-two remainders
+// multi-row statements cannot be padded, this keeps the number of their shapes bounded
+// example: chunks(300) -> {256, 32, 8, 4}
+inline std::vector<size_t> chunks(size_t count)
+{
+    std::vector<size_t> sizes;
+    while (count >= CHUNK_SIZE) {
+        sizes.push_back(CHUNK_SIZE);
+        count -= CHUNK_SIZE;
+    }
+    for (size_t size = CHUNK_SIZE / 2; size > 0; size /= 2) {
+        if (count >= size) {
+            sizes.push_back(size);
+            count -= size;
+        }
+    }
+    return sizes;
+}
+
+// multi_placeholder: generate the placeholder name of j-th value of i-th row
+// example: multi_placeholder(2, 3) -> "item2_3";
+inline std::string multi_placeholder(size_t i, size_t j)
+{
+    return "item" + std::to_string(i) + "_" + std::to_string(j);
+}
+
+// multi_insert: generate the SQL string for multivalue insert
+// Example:
+// multi_insert("INSERT INTO t_bios_foo", 2, 3, "ON DUPLICATE KEY ....") ->
+// 'INSERT INTO t_bios_foo (foo, bar)
+// VALUES(:item0_0, :item0_1),
+// (:item1_0, :item1_1),
+// (:item2_0, :item2_1)
+//  ON DUPLICATE KEY UPDATE ...'
+inline std::string multi_insert(
+    const std::string& sql_header, size_t tuple_len, size_t items_len, const std::string& sql_postfix)
+{
+    std::stringstream s{};
+
+    s << sql_header;
+    s << "\nVALUES ";
+    for (size_t i = 0; i != items_len; i++) {
+        s << "(";
+        for (size_t j = 0; j != tuple_len; j++) {
+            s << ":" << multi_placeholder(i, j);
+            if (j < tuple_len - 1)
+                s << ", ";
+        }
+        if (i < items_len - 1)
+            s << "),\n";
+        else
+            s << ")\n";
+    }
+    s << sql_postfix;
+    return s.str();
+}
+
+// power_device_subtypes: ids of subtypes counted by the licensing limit of power devices, as SQL list
+// (ids are fixed by the schema, so no lookup in t_bios_asset_device_type by name is needed)
+inline const std::string& power_device_subtypes()
+{
+    static const std::string list = std::to_string(persist::asset_subtype::EPDU) + ", " +
+                                    std::to_string(persist::asset_subtype::STS) + ", " +
+                                    std::to_string(persist::asset_subtype::UPS) + ", " +
+                                    std::to_string(persist::asset_subtype::PDU) + ", " +
+                                    std::to_string(persist::asset_subtype::GENSET);
+    return list;
+}
+
+} // namespace DBSql
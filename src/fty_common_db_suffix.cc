@@ -0,0 +1,254 @@
+/*  =========================================================================
+    fty_common_db_suffix - Allocation of unique asset name suffixes
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_suffix - Allocation of unique asset name suffixes
+@discuss
+@end
+*/
+
+#include "fty_common_db_suffix.h"
+#include "fty_common_db_session.h"
+#include "fty_common_db_sql.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fty_log.h>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <tntdb/row.h>
+#include <tntdb/statement.h>
+
+namespace fty::db {
+
+static constexpr uint64_t SUFFIX_LIMIT    = 100000000; // 8 digits
+static constexpr unsigned MAX_PROBE_RETRY = 10;
+
+static std::atomic<uint64_t> s_blocks{0};
+static std::atomic<uint64_t> s_allocated{0};
+static std::atomic<uint64_t> s_probed{0};
+
+// blocks are reserved per database, so are the suffixes left from them and the state of the sequence
+struct Pool
+{
+    std::deque<std::string> free;
+    bool                    exhausted = false; // all blocks are gone
+};
+
+static std::mutex                  s_mutex;
+static std::map<std::string, Pool> s_pools; // guarded by s_mutex, by database identity
+
+// s_format: 8 digit suffix with leading zeros
+static std::string s_format(uint64_t index)
+{
+    std::string str = std::to_string(index);
+    return std::string(8 - str.length(), '0') + str;
+}
+
+// s_used_suffixes: which of given suffixes already end a name of an asset
+// RIGHT(name, 8) cannot use an index, but it is one scan per 256 suffixes instead of one per suffix
+static std::set<std::string> s_used_suffixes(tntdb::Connection& conn, const std::vector<std::string>& list)
+{
+    std::set<std::string> used;
+    for (size_t offset = 0; offset < list.size(); offset += DBSql::CHUNK_SIZE) {
+        size_t count  = std::min(DBSql::CHUNK_SIZE, list.size() - offset);
+        size_t bucket = DBSql::chunk_bucket(count);
+
+        tntdb::Statement st = conn.prepareCached(
+            " SELECT"
+            "   DISTINCT RIGHT(name, 8)"
+            " FROM"
+            "   t_bios_asset_element"
+            " WHERE"
+            "   RIGHT(name, 8) IN (" +
+            DBSql::in_list("suffix", bucket) + ")");
+        for (size_t i = 0; i < bucket; i++) {
+            st.set(DBSql::placeholder("suffix", i), list[offset + std::min(i, count - 1)]);
+        }
+
+        for (const auto& row : st.select()) {
+            std::string suffix;
+            row[0].get(suffix);
+            used.insert(suffix);
+        }
+    }
+    return used;
+}
+
+// s_exhausted: true if all blocks of the database are gone
+static bool s_exhausted(const std::string& identity)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_pools[identity].exhausted;
+}
+
+// s_reserve_blocks: reserve count next blocks of the sequence of the database of conn
+// the table is created by database/mysql/0004_asset_name_sequence.sql
+// returns fewer blocks (or none) if the sequence cannot be used or is exhausted
+static std::vector<uint64_t> s_reserve_blocks(tntdb::Connection& conn, const std::string& identity, size_t count)
+{
+    const uint64_t        size = SuffixAllocator::BlockSize;
+    std::vector<uint64_t> blocks;
+    if (s_exhausted(identity)) {
+        return blocks;
+    }
+    try {
+        // the reservation must not be part of the transaction of the caller
+        tntdb::Connection seq = DBSession::connect(conn, true);
+        tntdb::Statement  st  = seq.prepareCached(" INSERT INTO t_bios_asset_name_sequence () VALUES ()");
+        while (blocks.size() < count) {
+            st.execute();
+            uint64_t block = uint64_t(seq.lastInsertId());
+            // blocks are numbered from 1, block covers suffixes [(block - 1) * size, block * size)
+            if (block * size > SUFFIX_LIMIT) {
+                log_error("asset name sequence of %s is exhausted, falling back to random suffixes", identity.c_str());
+                std::lock_guard<std::mutex> lock(s_mutex);
+                s_pools[identity].exhausted = true;
+                break;
+            }
+            blocks.push_back(block);
+            s_blocks++;
+        }
+    } catch (const std::exception& e) {
+        if (DBSession::missing_table(e)) {
+            log_error("t_bios_asset_name_sequence is missing (schema migration 0004_asset_name_sequence.sql not "
+                      "applied), falling back to random suffixes");
+        } else {
+            log_error("asset name sequence cannot be used, falling back to random suffixes: %s", e.what());
+        }
+    }
+    return blocks;
+}
+
+// s_free_suffixes: suffixes of blocks which do not end a name of an asset yet
+// all blocks are checked by one scan of names in the range of the blocks, which is done without s_mutex
+static std::vector<std::string> s_free_suffixes(tntdb::Connection& conn, const std::vector<uint64_t>& blocks)
+{
+    const uint64_t size = SuffixAllocator::BlockSize;
+    auto           low  = (*std::min_element(blocks.begin(), blocks.end()) - 1) * size;
+    auto           high = *std::max_element(blocks.begin(), blocks.end()) * size - 1;
+
+    // names which do not end with digits may fall into the range too, they are never candidates
+    std::set<std::string> used;
+    tntdb::Statement      st = conn.prepareCached(
+        " SELECT"
+        "   DISTINCT RIGHT(name, 8)"
+        " FROM"
+        "   t_bios_asset_element"
+        " WHERE"
+        "   RIGHT(name, 8) BETWEEN :low AND :high");
+    for (const auto& row : st.set("low", s_format(low)).set("high", s_format(high)).select()) {
+        std::string suffix;
+        row[0].get(suffix);
+        used.insert(suffix);
+    }
+
+    std::vector<std::string> free;
+    for (uint64_t block : blocks) {
+        for (uint64_t i = (block - 1) * size; i < block * size; i++) {
+            std::string suffix = s_format(i);
+            if (used.count(suffix) == 0) {
+                free.push_back(suffix);
+            }
+        }
+        log_debug("reserved asset name block %" PRIu64, block);
+    }
+    log_debug("%zu of %" PRIu64 " suffixes of reserved blocks are free", free.size(), blocks.size() * size);
+    return free;
+}
+
+// s_probe: random suffixes checked against existing names, as insert_into_asset_element always did
+static void s_probe(tntdb::Connection& conn, size_t count, std::vector<std::string>& suffixes)
+{
+    thread_local std::mt19937               generator(std::random_device{}());
+    std::uniform_int_distribution<uint64_t> distribution(0, SUFFIX_LIMIT - 1);
+
+    std::set<std::string> taken(suffixes.begin(), suffixes.end());
+    for (unsigned retry = 0; retry < MAX_PROBE_RETRY && suffixes.size() < count; retry++) {
+        std::vector<std::string> candidates;
+        while (candidates.size() < count - suffixes.size()) {
+            std::string suffix = s_format(distribution(generator));
+            if (taken.insert(suffix).second) {
+                candidates.push_back(suffix);
+            }
+        }
+        auto used = s_used_suffixes(conn, candidates);
+        for (const auto& suffix : candidates) {
+            if (used.count(suffix) == 0) {
+                suffixes.push_back(suffix);
+                s_probed++;
+            }
+        }
+    }
+    if (suffixes.size() < count) {
+        throw std::runtime_error("Multiple Asset ID collisions - impossible to create asset");
+    }
+}
+
+std::vector<std::string> SuffixAllocator::take(tntdb::Connection& conn, size_t count)
+{
+    std::string              identity = DBSession::identity(conn);
+    std::vector<std::string> suffixes;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        auto&                       free = s_pools[identity].free;
+        while (!free.empty() && suffixes.size() < count) {
+            suffixes.push_back(free.front());
+            free.pop_front();
+        }
+    }
+    // all missing blocks are reserved at once; a block may be fully used by names created with random suffixes,
+    // so reserve until enough is free
+    while (suffixes.size() < count) {
+        auto blocks = s_reserve_blocks(conn, identity, (count - suffixes.size() + BlockSize - 1) / BlockSize);
+        if (blocks.empty()) {
+            break;
+        }
+        auto free = s_free_suffixes(conn, blocks);
+        auto it   = free.begin();
+        for (; it != free.end() && suffixes.size() < count; ++it) {
+            suffixes.push_back(*it);
+        }
+        std::lock_guard<std::mutex> lock(s_mutex);
+        auto&                       pool = s_pools[identity].free;
+        pool.insert(pool.end(), it, free.end());
+    }
+    if (suffixes.size() < count) {
+        s_probe(conn, count, suffixes);
+    }
+    s_allocated += count;
+    return suffixes;
+}
+
+std::string SuffixAllocator::next(tntdb::Connection& conn)
+{
+    return take(conn, 1).front();
+}
+
+SuffixAllocator::Stats SuffixAllocator::stats()
+{
+    return {s_blocks, s_allocated, s_probed};
+}
+
+} // namespace fty::db
@@ -77,5 +77,39 @@ bool get_dc_upses(const char* asset_name, zhash_t* hash)
     return true;
 }
 
+bool get_dcs_upses(std::map<std::string, std::vector<std::string>>& dc_upses)
+{
+    tntdb::Connection conn = tntdb::connectCached(DBConn::url);
+
+    auto res = DBAssets::read_short_elements(conn, persist::asset_type::DATACENTER, 0);
+    if (!res) {
+        conn.close();
+        return false;
+    }
+    auto dcs = std::move(res).value();
+
+    dc_upses.clear();
+    std::vector<uint32_t> dc_ids;
+    for (const auto& dc : dcs) {
+        dc_ids.push_back(dc.first);
+        dc_upses[dc.second];
+    }
+
+    std::function<void(uint32_t, const tntdb::Row&)> cb = [&dc_upses, &dcs](uint32_t dc_id, const tntdb::Row& row) {
+        std::string device_name = "";
+        row["name"].get(device_name);
+        dc_upses[dcs[dc_id]].push_back(device_name);
+    };
+
+    int rv = DBAssets::select_assets_by_containers(conn, dc_ids,
+        DBAssets::AssetFilter{{persist::asset_type::DEVICE}, {persist::asset_subtype::UPS}, "active", "", ""}, cb);
+
+    conn.close();
+    if (rv != 0) {
+        dc_upses.clear();
+        return false;
+    }
+    return true;
+}
 
 } // namespace DBUptime
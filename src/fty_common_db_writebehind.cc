@@ -0,0 +1,364 @@
+/*  =========================================================================
+    fty_common_db_writebehind - Write-behind buffer of read-only ext attributes
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_db_writebehind - Write-behind buffer of read-only ext attributes
+@discuss
+@end
+*/
+
+#include "fty_common_db_writebehind.h"
+#include "fty_common_db_change.h"
+#include "fty_common_db_dbpath.h"
+#include "fty_common_db_notifier.h"
+#include "fty_common_db_sql.h"
+#include <atomic>
+#include <condition_variable>
+#include <fty_log.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tntdb/statement.h>
+
+namespace fty::db {
+
+using Key = std::pair<uint32_t, std::string>; // asset, keytag
+
+static std::atomic<bool>     s_enabled{false};
+static std::atomic<uint64_t> s_queued{0};
+static std::atomic<uint64_t> s_dropped{0};
+static std::atomic<uint64_t> s_coalesced{0};
+static std::atomic<uint64_t> s_written{0};
+static std::atomic<uint64_t> s_flushes{0};
+static std::atomic<uint64_t> s_failures{0};
+static std::atomic<uint64_t> s_rejected{0};
+static std::atomic<uint64_t> s_last_flush_usec{0};
+static std::atomic<uint64_t> s_max_flush_usec{0};
+static std::atomic<uint64_t> s_sum_flush_usec{0};
+
+static std::mutex                 s_mutex;
+static std::condition_variable    s_cond;
+static std::map<Key, std::string> s_pending;   // guarded by s_mutex
+static std::map<Key, std::string> s_stored;    // values in database, guarded by s_mutex
+static size_t                     s_threshold;        // guarded by s_mutex
+static bool                       s_stopping = false; // guarded by s_mutex
+static uint64_t                   s_forgets  = 0;     // number of s_forget calls, guarded by s_mutex
+
+static std::mutex s_control_mutex; // serializes enable and flush
+static uint64_t   s_observer = 0;
+
+static thread_local bool s_flushing = false; // events of this thread are raised by s_flush itself
+
+// s_forget: stored values of asset (of all assets if 0) are not known anymore
+static void s_forget(const ChangeEvent& event)
+{
+    if (event.table != "t_bios_asset_ext_attributes" || s_flushing) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_forgets++;
+    if (event.assetId == 0) {
+        s_stored.clear();
+        return;
+    }
+    s_stored.erase(s_stored.lower_bound({event.assetId, ""}), s_stored.lower_bound({event.assetId + 1, ""}));
+}
+
+using Entry = std::pair<Key, std::string>;
+
+// s_upsert: write size entries of list from offset by one statement
+static void s_upsert(tntdb::Connection& conn, const std::vector<Entry>& list, size_t offset, size_t size)
+{
+    tntdb::Statement st = conn.prepareCached(DBSql::multi_insert(
+        "INSERT INTO t_bios_asset_ext_attributes (keytag, value, id_asset_element, read_only) ", 4, size,
+        " ON DUPLICATE KEY UPDATE"
+        "   value = VALUES (value),"
+        "   read_only = 1"));
+    for (size_t i = 0; i < size; i++) {
+        st.set(DBSql::multi_placeholder(i, 0), list[offset + i].first.second);
+        st.set(DBSql::multi_placeholder(i, 1), list[offset + i].second);
+        st.set(DBSql::multi_placeholder(i, 2), list[offset + i].first.first);
+        st.set(DBSql::multi_placeholder(i, 3), true);
+    }
+    st.execute();
+}
+
+// s_write: write list, returns entries written
+// if a statement fails, the entries are written one by one and those failing alone (e.g. of a deleted asset) are
+// rejected; throws if none can be written, the database is probably not available then
+static std::vector<Entry> s_write(tntdb::Connection& conn, const std::vector<Entry>& list)
+{
+    try {
+        size_t done = 0;
+        for (size_t size : DBSql::chunks(list.size())) {
+            s_upsert(conn, list, done, size);
+            done += size;
+        }
+        return list;
+    } catch (const std::exception& e) {
+        log_error("flush of %zu ext attributes failed, writing them one by one: %s", list.size(), e.what());
+
+        std::vector<Entry> written;
+        for (size_t i = 0; i < list.size(); i++) {
+            try {
+                s_upsert(conn, list, i, 1);
+                written.push_back(list[i]);
+            } catch (const std::exception& row_error) {
+                log_debug("ext attribute %s of asset %" PRIu32 " rejected: %s", list[i].first.second.c_str(),
+                    list[i].first.first, row_error.what());
+            }
+        }
+        if (written.empty()) {
+            throw;
+        }
+        s_failures++;
+        log_error("%zu ext attributes rejected", list.size() - written.size());
+        s_rejected += list.size() - written.size();
+        return written;
+    }
+}
+
+// s_flush: write queued values, s_control_mutex must be locked
+static int s_flush()
+{
+    std::map<Key, std::string> batch;
+    uint64_t                   forgets;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        batch.swap(s_pending);
+        forgets = s_forgets;
+    }
+    if (batch.empty()) {
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        tntdb::Connection  conn    = tntdb::connectCached(DBConn::url);
+        std::vector<Entry> written = s_write(conn, std::vector<Entry>(batch.begin(), batch.end()));
+
+        // written values are remembered unless something was forgotten meanwhile, it could be one of them
+        std::set<uint32_t> assets;
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            bool                        remember = s_forgets == forgets;
+            for (const auto& it : written) {
+                if (remember) {
+                    s_stored[it.first] = it.second;
+                }
+                assets.insert(it.first.first);
+            }
+        }
+        // delivered to s_forget in this thread (unless flush is called under a Deferral), which ignores them
+        s_flushing = true;
+        try {
+            DBChange::record_many(conn, "t_bios_asset_ext_attributes", DBChange::Op::Update,
+                std::vector<uint32_t>(assets.begin(), assets.end()));
+        } catch (const std::exception& e) {
+            log_error("flushed ext attributes were not recorded: %s", e.what());
+        }
+        s_flushing = false;
+        s_written += written.size();
+        s_flushes++;
+    } catch (const std::exception& e) {
+        log_error("flush of %zu ext attributes failed: %s", batch.size(), e.what());
+        s_failures++;
+        // queue them again, unless a newer value came meanwhile
+        std::lock_guard<std::mutex> lock(s_mutex);
+        for (auto& it : batch) {
+            s_pending.insert(std::move(it));
+        }
+        return -1;
+    }
+
+    uint64_t usec = uint64_t(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    s_last_flush_usec = usec;
+    s_sum_flush_usec += usec;
+    if (usec > s_max_flush_usec) {
+        s_max_flush_usec = usec;
+    }
+    log_debug("%zu ext attributes flushed in %" PRIu64 " us", batch.size(), usec);
+    return 0;
+}
+
+static void s_run(std::chrono::milliseconds interval)
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(s_mutex);
+            s_cond.wait_for(lock, interval, []() {
+                return s_stopping || s_pending.size() >= s_threshold;
+            });
+            if (s_stopping) {
+                return;
+            }
+        }
+        std::lock_guard<std::mutex> lock(s_control_mutex);
+        s_flush();
+    }
+}
+
+// Flusher: the background thread of the buffer
+// destroyed (stopped) at exit before s_mutex and s_pending, which were constructed before it; values queued then
+// are lost, enable(false) flushes them
+class Flusher
+{
+public:
+    ~Flusher()
+    {
+        stop();
+    }
+
+    bool running() const
+    {
+        return m_thread.joinable();
+    }
+
+    void start(std::chrono::milliseconds interval)
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_stopping = false;
+        }
+        m_thread = std::thread(s_run, interval);
+    }
+
+    // stop: s_control_mutex must not be locked, s_run takes it to flush
+    void stop()
+    {
+        if (!m_thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_stopping = true;
+        }
+        s_cond.notify_all();
+        m_thread.join();
+    }
+
+private:
+    std::thread m_thread;
+};
+
+static Flusher& s_flusher()
+{
+    static Flusher flusher;
+    return flusher;
+}
+
+void ExtAttributeWriteBehind::enable(bool enabled, std::chrono::milliseconds interval, size_t threshold)
+{
+    std::unique_lock<std::mutex> control(s_control_mutex);
+    if (s_flusher().running()) {
+        // stop the current thread first, also when only parameters change
+        s_enabled = false;
+        control.unlock();
+        s_flusher().stop();
+        control.lock();
+        s_flush();
+        ChangeNotifier::unsubscribe(s_observer);
+    }
+
+    log_debug("ext attribute write-behind %s", enabled ? "enabled" : "disabled");
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_stored.clear();
+        s_threshold = std::max(threshold, size_t(1));
+    }
+    if (enabled) {
+        s_observer = ChangeNotifier::subscribe(s_forget);
+        s_flusher().start(interval);
+        s_enabled = true;
+    }
+}
+
+bool ExtAttributeWriteBehind::enabled()
+{
+    return s_enabled;
+}
+
+bool ExtAttributeWriteBehind::write(uint32_t assetId, const std::string& keytag, const std::string& value)
+{
+    if (!enabled()) {
+        return false;
+    }
+
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        Key                         key{assetId, keytag};
+
+        auto pending = s_pending.find(key);
+        if (pending != s_pending.end()) {
+            if (pending->second == value) {
+                s_dropped++;
+            } else {
+                pending->second = value;
+                s_coalesced++;
+            }
+            return true;
+        }
+        auto stored = s_stored.find(key);
+        if (stored != s_stored.end() && stored->second == value) {
+            s_dropped++;
+            return true;
+        }
+        s_pending.emplace(key, value);
+        s_queued++;
+        full = s_pending.size() >= s_threshold;
+    }
+    if (full) {
+        s_cond.notify_all();
+    }
+    return true;
+}
+
+int ExtAttributeWriteBehind::flush()
+{
+    std::lock_guard<std::mutex> lock(s_control_mutex);
+    return s_flush();
+}
+
+ExtAttributeWriteBehind::Stats ExtAttributeWriteBehind::stats()
+{
+    return {s_queued, s_dropped, s_coalesced, s_written, s_flushes, s_failures, s_rejected, s_last_flush_usec,
+        s_max_flush_usec, s_sum_flush_usec};
+}
+
+void ExtAttributeWriteBehind::resetStats()
+{
+    s_queued          = 0;
+    s_dropped         = 0;
+    s_coalesced       = 0;
+    s_written         = 0;
+    s_flushes         = 0;
+    s_failures        = 0;
+    s_rejected        = 0;
+    s_last_flush_usec = 0;
+    s_max_flush_usec  = 0;
+    s_sum_flush_usec  = 0;
+}
+
+} // namespace fty::db
@@ -1,7 +1,114 @@
 #define CATCH_CONFIG_MAIN
 #define CATCH_CONFIG_DISABLE_EXCEPTIONS
 #include <catch2/catch.hpp>
+#include "fty_common_db.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
 
 TEST_CASE("Empty test")
 {
-}
\ No newline at end of file
+}
+
+// Tests below need a database with the 42ity schema, for example a local MariaDB:
+//     FTY_TEST_DB_URL="mysql:db=box_utf8;user=root" ./fty_common_db-test
+// They are skipped if FTY_TEST_DB_URL is not set. Benchmarks are hidden, run them by their tag:
+//     FTY_TEST_DB_URL="mysql:db=box_utf8;user=root" ./fty_common_db-test "[!benchmark]"
+static const char* s_test_db_url()
+{
+    return getenv("FTY_TEST_DB_URL");
+}
+
+TEST_CASE("select_asset_element_by_dc is repeatable on one connection")
+{
+    if (!s_test_db_url()) {
+        WARN("FTY_TEST_DB_URL is not set, test skipped");
+        return;
+    }
+
+    tntdb::Connection conn = tntdb::connect(s_test_db_url());
+
+    auto dcs = DBAssets::select_short_elements(conn, persist::asset_type::DATACENTER, 0);
+    REQUIRE(dcs.status == 1);
+    if (dcs.item.empty()) {
+        WARN("no datacenter in database, test skipped");
+        return;
+    }
+    int64_t dc_id = dcs.item.begin()->first;
+
+    size_t                                 rows = 0;
+    std::function<void(const tntdb::Row&)> cb   = [&rows](const tntdb::Row&) {
+        rows++;
+    };
+
+    REQUIRE(DBAssets::select_asset_element_by_dc(conn, dc_id, cb) == 0);
+    size_t expected = rows;
+    CHECK(expected > 0); // the datacenter itself
+
+    // the statement is served from the statement cache from now on
+    for (int i = 0; i < 100; i++) {
+        rows = 0;
+        REQUIRE(DBAssets::select_asset_element_by_dc(conn, dc_id, cb) == 0);
+        CHECK(rows == expected);
+    }
+}
+
+TEST_CASE("select_asset_element_by_dc benchmark", "[!benchmark]")
+{
+    if (!s_test_db_url()) {
+        WARN("FTY_TEST_DB_URL is not set, test skipped");
+        return;
+    }
+
+    tntdb::Connection conn = tntdb::connect(s_test_db_url());
+
+    auto dcs = DBAssets::select_short_elements(conn, persist::asset_type::DATACENTER, 0);
+    REQUIRE(dcs.status == 1);
+    if (dcs.item.empty()) {
+        WARN("no datacenter in database, test skipped");
+        return;
+    }
+    int64_t dc_id = dcs.item.begin()->first;
+
+    static const int runs = 200;
+
+    // former implementation: nested SELECT prepared on every call
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        tntdb::Statement st = conn.prepare(
+            "SELECT "
+            "   v.id, v.name, v.type_name, "
+            "   v.subtype_name, v.id_parent, "
+            "   v.status, v.priority, "
+            "   v.asset_tag "
+            " FROM "
+            "   v_web_element v "
+            "WHERE "
+            "   v.id in "
+            "   ( "
+            " SELECT p.id_asset_element "
+            " FROM v_bios_asset_element_super_parent p "
+            " WHERE "
+            "   :containerid in ( p.id_asset_element, p.id_parent1, p.id_parent2, "
+            "                     p.id_parent3, p.id_parent4, p.id_parent5, "
+            "                     p.id_parent6, p.id_parent7, p.id_parent8, "
+            "                     p.id_parent9, p.id_parent10) "
+            "   ) ");
+        for (const auto& row : st.set("containerid", dc_id).select()) {
+            (void)row;
+        }
+    }
+    auto before = std::chrono::steady_clock::now() - start;
+
+    std::function<void(const tntdb::Row&)> cb = [](const tntdb::Row&) {};
+    start                                      = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        REQUIRE(DBAssets::select_asset_element_by_dc(conn, dc_id, cb) == 0);
+    }
+    auto after = std::chrono::steady_clock::now() - start;
+
+    using us = std::chrono::microseconds;
+    std::cout << "select_asset_element_by_dc, mean of " << runs << " runs: "
+              << "prepare + nested SELECT " << std::chrono::duration_cast<us>(before).count() / runs << " us, "
+              << "prepareCached + JOIN " << std::chrono::duration_cast<us>(after).count() / runs << " us" << std::endl;
+}